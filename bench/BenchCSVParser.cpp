@@ -0,0 +1,104 @@
+#include "DataParser.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Compares the mmap/from_chars CSV parser against the previous
+// ifstream -> istringstream -> stringstream-per-line implementation.
+
+namespace
+{
+    constexpr int ITERATIONS = 50;
+
+    // Previous DataParserCSVAlphaAPI::parseData, kept here as the baseline
+    std::vector<MarketDataEntry> parseLegacy(const std::string &path)
+    {
+        std::vector<MarketDataEntry> data;
+        std::ifstream file(path);
+        std::vector<char> buffer(std::istreambuf_iterator<char>(file), {});
+        std::istringstream fileContent(std::string(buffer.data(), buffer.size()));
+
+        std::string line;
+        std::getline(fileContent, line);
+        while (std::getline(fileContent, line))
+        {
+            std::stringstream ss(line);
+            std::string timestamp;
+            double open, high, low, close, volume;
+            if (std::getline(ss, timestamp, ',') &&
+                ss >> open && ss.ignore(1) &&
+                ss >> high && ss.ignore(1) &&
+                ss >> low && ss.ignore(1) &&
+                ss >> close && ss.ignore(1) &&
+                ss >> volume)
+            {
+                Timestamp parsed;
+                Timestamp::parse(timestamp, parsed);
+                data.emplace_back(parsed, open, high, low, close, volume);
+            }
+        }
+        std::sort(data.begin(), data.end(), [](const MarketDataEntry &a, const MarketDataEntry &b)
+                  { return a.m_timestamp < b.m_timestamp; });
+        return data;
+    }
+
+    std::vector<MarketDataEntry> parseMapped(const std::string &path)
+    {
+        DataParserCSVAlphaAPI parser(path);
+        parser.parseData();
+        return parser.getData();
+    }
+
+    template <typename ParseFn>
+    double timeRowsPerSecond(ParseFn parse, const std::string &path, std::size_t &rows)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; ++i)
+        {
+            rows = parse(path).size();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return static_cast<double>(rows) * ITERATIONS / elapsed.count();
+    }
+
+    bool sameEntries(const std::vector<MarketDataEntry> &a, const std::vector<MarketDataEntry> &b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const MarketDataEntry &x, const MarketDataEntry &y)
+                          { return x.m_timestamp == y.m_timestamp && x.m_open == y.m_open && x.m_high == y.m_high &&
+                                   x.m_low == y.m_low && x.m_close == y.m_close && x.m_volume == y.m_volume; });
+    }
+}
+
+int main()
+{
+    // Keep per-parse log lines out of the timing output
+    Logger::getInstance().setLogFile("bench_log.txt");
+
+    const std::vector<std::string> symbols = {"AAPL", "MSFT", "GOOGL"};
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (const auto &symbol : symbols)
+    {
+        std::string path = std::string(DATA_FOLDER) + "/market_data_" + symbol + ".csv";
+
+        if (!sameEntries(parseLegacy(path), parseMapped(path)))
+        {
+            std::cerr << "Parsers disagree on " << path << std::endl;
+            return 1;
+        }
+
+        std::size_t rows = 0;
+        double legacy = timeRowsPerSecond(parseLegacy, path, rows);
+        double mapped = timeRowsPerSecond(parseMapped, path, rows);
+
+        std::cout << symbol << " (" << rows << " rows): legacy " << legacy / 1e6 << " Mrows/s, mapped "
+                  << mapped / 1e6 << " Mrows/s, speedup " << mapped / legacy << "x" << std::endl;
+    }
+    return 0;
+}
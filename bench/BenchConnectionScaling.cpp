@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <utility>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+// Load generator for a running server: holds 10/100/1000/5000 idle client
+// connections open and reports the server's resident memory, its thread count
+// and the command round-trip latency seen by the clients at each level.
+//
+// Usage: BenchConnectionScaling [host] [port] [server pid]
+// Both this process and the server need a file descriptor limit above the
+// largest level (e.g. "ulimit -n 20000" before starting each of them).
+
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace
+{
+    const std::vector<std::size_t> LEVELS = {10, 100, 1000, 5000};
+    constexpr std::size_t ROUND_TRIPS = 500;
+
+    // Unknown symbols are answered with a single ERROR line in the text protocol
+    const std::string PROBE = "GET BENCH_PROBE\n";
+
+    struct ProcessStatus
+    {
+        long rssKb = -1;
+        long threads = -1;
+    };
+
+    ProcessStatus readStatus(const std::string &pid)
+    {
+        ProcessStatus status;
+        std::ifstream file("/proc/" + pid + "/status");
+        std::string key;
+        while (file >> key)
+        {
+            if (key == "VmRSS:")
+            {
+                file >> status.rssKb;
+            }
+            else if (key == "Threads:")
+            {
+                file >> status.threads;
+            }
+            file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+        return status;
+    }
+
+    void raiseDescriptorLimit()
+    {
+#if defined(__linux__)
+        rlimit limit{};
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+        {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+#endif
+    }
+
+    double percentile(std::vector<double> samples, double p)
+    {
+        if (samples.empty())
+        {
+            return 0.0;
+        }
+        std::sort(samples.begin(), samples.end());
+        std::size_t index = static_cast<std::size_t>(p * (samples.size() - 1));
+        return samples[index];
+    }
+
+    // Round trips spread over the open connections, newest first: connections are
+    // accepted in order, so once the newest answers the server holds all of them
+    std::vector<double> measureLatency(std::vector<std::unique_ptr<tcp::socket>> &sockets)
+    {
+        std::vector<double> micros;
+        micros.reserve(ROUND_TRIPS);
+        net::streambuf reply;
+        for (std::size_t i = 0; i < ROUND_TRIPS; ++i)
+        {
+            tcp::socket &socket = *sockets[sockets.size() - 1 - (i * 7919) % sockets.size()];
+            auto start = std::chrono::steady_clock::now();
+            net::write(socket, net::buffer(PROBE));
+            std::size_t n = net::read_until(socket, reply, '\n');
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            reply.consume(n);
+            micros.push_back(elapsed.count());
+        }
+        return micros;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const std::string host = argc > 1 ? argv[1] : "127.0.0.1";
+    const std::string port = argc > 2 ? argv[2] : "8080";
+    const std::string pid = argc > 3 ? argv[3] : "";
+
+    raiseDescriptorLimit();
+
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    auto endpoints = resolver.resolve(host, port);
+
+    std::vector<std::unique_ptr<tcp::socket>> sockets;
+    ProcessStatus baseline = pid.empty() ? ProcessStatus{} : readStatus(pid);
+
+    std::cout << "Connection scaling against " << host << ":" << port << "\n";
+    if (!pid.empty())
+    {
+        std::cout << "Idle server: " << baseline.rssKb << " kB RSS, " << baseline.threads << " threads\n";
+    }
+    std::cout << std::setw(8) << "clients" << std::setw(14) << "connect ms" << std::setw(12) << "rss kB"
+              << std::setw(14) << "kB/client" << std::setw(10) << "threads" << std::setw(12) << "p50 us"
+              << std::setw(12) << "p99 us" << "\n";
+
+    try
+    {
+        for (std::size_t level : LEVELS)
+        {
+            auto start = std::chrono::steady_clock::now();
+            while (sockets.size() < level)
+            {
+                auto socket = std::make_unique<tcp::socket>(ioc);
+                net::connect(*socket, endpoints);
+                socket->set_option(tcp::no_delay(true));
+                sockets.push_back(std::move(socket));
+            }
+            std::chrono::duration<double, std::milli> connectTime = std::chrono::steady_clock::now() - start;
+
+            // Latency first so the memory sample is taken with every session established
+            std::vector<double> latency = measureLatency(sockets);
+            ProcessStatus status = pid.empty() ? ProcessStatus{} : readStatus(pid);
+            double perClient = status.rssKb < 0 ? 0.0 : static_cast<double>(status.rssKb - baseline.rssKb) / level;
+
+            std::cout << std::fixed << std::setprecision(1)
+                      << std::setw(8) << level << std::setw(14) << connectTime.count() << std::setw(12) << status.rssKb
+                      << std::setw(14) << perClient << std::setw(10) << status.threads
+                      << std::setw(12) << percentile(latency, 0.50) << std::setw(12) << percentile(latency, 0.99) << "\n";
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Stopped at " << sockets.size() << " connections: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
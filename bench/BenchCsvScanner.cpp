@@ -0,0 +1,85 @@
+#include "CsvScanner.hpp"
+#include "MappedFile.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Times the structural index pass for each kernel the CPU supports over a
+// replay-sized buffer built by repeating the rows of data/market_data_AAPL.csv.
+//
+// Usage: BenchCsvScanner [rows]   (default 2,000,000)
+
+namespace
+{
+    constexpr int ITERATIONS = 10;
+
+    std::string buildReplayBuffer(std::size_t targetRows)
+    {
+        MappedFile sample(std::string(DATA_FOLDER) + "/market_data_AAPL.csv");
+        std::string_view content = sample.view();
+        std::size_t headerEnd = content.find('\n');
+        std::string_view header = content.substr(0, headerEnd + 1);
+        std::string_view rows = content.substr(headerEnd + 1);
+
+        std::size_t rowsPerCopy = 0;
+        for (char c : rows)
+        {
+            rowsPerCopy += (c == '\n');
+        }
+
+        std::string buffer(header);
+        buffer.reserve(header.size() + rows.size() * (targetRows / rowsPerCopy + 1));
+        for (std::size_t produced = 0; produced < targetRows; produced += rowsPerCopy)
+        {
+            buffer.append(rows);
+        }
+        return buffer;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t targetRows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    std::string buffer = buildReplayBuffer(targetRows);
+    std::cout << "Buffer: " << buffer.size() / (1024 * 1024) << " MiB" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    CsvScanner::StructuralIndex reference;
+    CsvScanner::buildIndex(buffer, reference, CsvScanner::Kernel::Scalar);
+    double scalarSeconds = 0.0;
+
+    for (auto kernel : {CsvScanner::Kernel::Scalar, CsvScanner::Kernel::SSE2, CsvScanner::Kernel::AVX2})
+    {
+        if (!CsvScanner::isKernelSupported(kernel))
+        {
+            std::cout << CsvScanner::kernelName(kernel) << ": not supported on this CPU" << std::endl;
+            continue;
+        }
+
+        CsvScanner::StructuralIndex index;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; ++i)
+        {
+            CsvScanner::buildIndex(buffer, index, kernel);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double seconds = elapsed.count() / ITERATIONS;
+        if (kernel == CsvScanner::Kernel::Scalar)
+        {
+            scalarSeconds = seconds;
+        }
+
+        if (index.delimiters != reference.delimiters || index.rowEnds != reference.rowEnds)
+        {
+            std::cerr << CsvScanner::kernelName(kernel) << ": index differs from scalar reference" << std::endl;
+            return 1;
+        }
+
+        std::cout << CsvScanner::kernelName(kernel) << ": " << buffer.size() / seconds / 1e9 << " GB/s, "
+                  << index.rowEnds.size() - 1 << " rows, " << scalarSeconds / seconds << "x vs scalar" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,372 @@
+#include "BenchHarness.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace
+{
+    std::atomic<std::uint64_t> g_allocations{0};
+    std::atomic<std::uint64_t> g_allocatedBytes{0};
+
+    void *allocate(std::size_t size)
+    {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        return std::malloc(size ? size : 1);
+    }
+
+    void *allocateAligned(std::size_t size, std::align_val_t alignment)
+    {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        const std::size_t align = static_cast<std::size_t>(alignment);
+        // aligned_alloc wants a non-zero multiple of the alignment
+        const std::size_t rounded = (std::max<std::size_t>(size, 1) + align - 1) / align * align;
+#ifdef _WIN32
+        return _aligned_malloc(rounded, align);
+#else
+        return std::aligned_alloc(align, rounded);
+#endif
+    }
+
+    // Kept out of line: GCC flags free() on memory it sees come from operator new once inlined
+#if defined(__GNUC__)
+#define FLASHFEED_BENCH_NOINLINE __attribute__((noinline))
+#else
+#define FLASHFEED_BENCH_NOINLINE
+#endif
+    FLASHFEED_BENCH_NOINLINE void release(void *memory)
+    {
+        std::free(memory);
+    }
+
+    FLASHFEED_BENCH_NOINLINE void releaseAligned(void *memory)
+    {
+#ifdef _WIN32
+        _aligned_free(memory);
+#else
+        std::free(memory);
+#endif
+    }
+
+    struct Registered
+    {
+        std::string name;
+        bench::Function function;
+    };
+
+    std::vector<Registered> &registry()
+    {
+        static std::vector<Registered> benchmarks;
+        return benchmarks;
+    }
+
+    struct Options
+    {
+        std::string filter;
+        std::string jsonPath;
+        double minTime = 0.5; // Seconds a measured run must last
+    };
+
+    bool parseOptions(int argc, char *argv[], Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+            auto value = [&argument](const char *prefix)
+            { return argument.substr(std::char_traits<char>::length(prefix)); };
+            if (argument.rfind("--filter=", 0) == 0)
+            {
+                options.filter = value("--filter=");
+            }
+            else if (argument.rfind("--json=", 0) == 0)
+            {
+                options.jsonPath = value("--json=");
+            }
+            else if (argument.rfind("--min-time=", 0) == 0)
+            {
+                options.minTime = std::atof(value("--min-time=").c_str());
+            }
+            else
+            {
+                std::cerr << "Unknown argument " << argument << "\n"
+                          << "Usage: " << argv[0] << " [--filter=<substring>] [--min-time=<seconds>] [--json=<file>]\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Runs with more iterations until one run lasts at least minTime, like Google Benchmark
+    bench::State measure(const bench::Function &function, double minTime)
+    {
+        constexpr std::uint64_t MAX_ITERATIONS = 1'000'000'000;
+        std::uint64_t iterations = 1;
+        for (;;)
+        {
+            bench::State state(iterations);
+            function(state);
+            const double seconds = std::chrono::duration<double>(state.elapsed()).count();
+            if (seconds >= minTime || iterations >= MAX_ITERATIONS)
+            {
+                return state;
+            }
+            // Aim 40% past the target so the next run is usually the last
+            double multiplier = seconds > 0 ? minTime * 1.4 / seconds : 10.0;
+            multiplier = std::clamp(multiplier, 2.0, 10.0);
+            iterations = std::min(MAX_ITERATIONS, static_cast<std::uint64_t>(static_cast<double>(iterations) * multiplier));
+        }
+    }
+
+    std::string humanRate(double perSecond, const char *unit)
+    {
+        const char *prefixes[] = {"", "k", "M", "G", "T"};
+        int prefix = 0;
+        while (perSecond >= 1000.0 && prefix < 4)
+        {
+            perSecond /= 1000.0;
+            ++prefix;
+        }
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(perSecond < 10 ? 2 : 1) << perSecond << prefixes[prefix] << unit;
+        return out.str();
+    }
+}
+
+// Every heap allocation in the benchmark executable is counted
+void *operator new(std::size_t size)
+{
+    if (void *memory = allocate(size))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    release(memory);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void *memory = allocateAligned(size, alignment))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocateAligned(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+    releaseAligned(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept
+{
+    releaseAligned(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept
+{
+    releaseAligned(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept
+{
+    releaseAligned(memory);
+}
+
+namespace bench
+{
+    bool State::keepRunning()
+    {
+        if (!m_started)
+        {
+            m_started = true;
+            m_remaining = m_iterations;
+            start();
+        }
+        if (m_remaining > 0)
+        {
+            --m_remaining;
+            return true;
+        }
+        if (!m_paused)
+        {
+            stop();
+            m_paused = true;
+        }
+        return false;
+    }
+
+    void State::pauseTiming()
+    {
+        if (!m_paused)
+        {
+            stop();
+            m_paused = true;
+        }
+    }
+
+    void State::resumeTiming()
+    {
+        if (m_paused)
+        {
+            m_paused = false;
+            start();
+        }
+    }
+
+    void State::start()
+    {
+        m_allocationsAtResume = g_allocations.load(std::memory_order_relaxed);
+        m_bytesAtResume = g_allocatedBytes.load(std::memory_order_relaxed);
+        m_resumed = Clock::now();
+    }
+
+    void State::stop()
+    {
+        m_elapsed += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_resumed);
+        m_allocations += g_allocations.load(std::memory_order_relaxed) - m_allocationsAtResume;
+        m_allocatedBytes += g_allocatedBytes.load(std::memory_order_relaxed) - m_bytesAtResume;
+    }
+
+    bool registerBenchmark(std::string name, Function function)
+    {
+        registry().push_back({std::move(name), std::move(function)});
+        return true;
+    }
+
+    int runBenchmarks(int argc, char *argv[])
+    {
+        Options options;
+        if (!parseOptions(argc, argv, options))
+        {
+            return 2;
+        }
+
+        nlohmann::json results = nlohmann::json::array();
+        std::cout << std::left << std::setw(28) << "benchmark" << std::right << std::setw(12) << "iterations"
+                  << std::setw(14) << "ns/op" << std::setw(13) << "bytes/s" << std::setw(13) << "items/s"
+                  << std::setw(12) << "allocs/op" << std::setw(14) << "alloc B/op" << "  label\n";
+
+        for (const Registered &benchmark : registry())
+        {
+            if (benchmark.name.find(options.filter) == std::string::npos)
+            {
+                continue;
+            }
+            const State state = measure(benchmark.function, options.minTime);
+            const double iterations = static_cast<double>(state.iterations());
+            const double seconds = std::chrono::duration<double>(state.elapsed()).count();
+            const double nsPerOp = static_cast<double>(state.elapsed().count()) / iterations;
+            const double bytesPerSecond = seconds > 0 ? static_cast<double>(state.bytesProcessed()) / seconds : 0.0;
+            const double itemsPerSecond = seconds > 0 ? static_cast<double>(state.itemsProcessed()) / seconds : 0.0;
+            const double allocsPerOp = static_cast<double>(state.allocations()) / iterations;
+            const double allocBytesPerOp = static_cast<double>(state.allocatedBytes()) / iterations;
+
+            std::cout << std::left << std::setw(28) << benchmark.name << std::right << std::setw(12) << state.iterations()
+                      << std::fixed << std::setprecision(1) << std::setw(14) << nsPerOp
+                      << std::setw(13) << (state.bytesProcessed() ? humanRate(bytesPerSecond, "B") : "-")
+                      << std::setw(13) << (state.itemsProcessed() ? humanRate(itemsPerSecond, "") : "-")
+                      << std::setprecision(2) << std::setw(12) << allocsPerOp
+                      << std::setprecision(0) << std::setw(14) << allocBytesPerOp
+                      << "  " << state.label() << std::endl;
+
+            results.push_back({{"name", benchmark.name},
+                               {"iterations", state.iterations()},
+                               {"real_time_ns", state.elapsed().count()},
+                               {"ns_per_op", nsPerOp},
+                               {"bytes_per_second", bytesPerSecond},
+                               {"items_per_second", itemsPerSecond},
+                               {"allocs_per_op", allocsPerOp},
+                               {"alloc_bytes_per_op", allocBytesPerOp},
+                               {"label", state.label()}});
+        }
+
+        if (!options.jsonPath.empty())
+        {
+            char date[32] = {};
+            const std::time_t now = std::time(nullptr);
+            std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+            nlohmann::json report = {
+                {"context", {{"date", date},
+                             {"executable", argv[0]},
+                             {"num_cpus", std::thread::hardware_concurrency()},
+                             {"min_time_seconds", options.minTime},
+#ifdef NDEBUG
+                             {"build_type", "release"}
+#else
+                             {"build_type", "debug"}
+#endif
+                            }},
+                {"benchmarks", results}};
+            std::ofstream file(options.jsonPath);
+            file << report.dump(2) << "\n";
+            if (!file)
+            {
+                std::cerr << "Cannot write " << options.jsonPath << "\n";
+                return 1;
+            }
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+
+/**
+ * @brief Minimal in-tree benchmark harness in the style of Google Benchmark.
+ *
+ * A benchmark is a function taking a State and looping on keepRunning():
+ *
+ *     void parseCsv(bench::State &state)
+ *     {
+ *         while (state.keepRunning())
+ *         {
+ *             ...
+ *         }
+ *         state.setBytesProcessed(state.iterations() * fileSize);
+ *     }
+ *     FLASHFEED_BENCHMARK(parseCsv);
+ *
+ * The runner calibrates the iteration count until a run lasts at least the
+ * minimum time, then reports ns/op, bytes/s and heap allocations per
+ * iteration. Allocations are counted by replacing the global operator new in
+ * the benchmark executable, so they include every thread's allocations while
+ * the benchmark runs.
+ *
+ * Command line: --filter=<substring> --min-time=<seconds> --json=<file>
+ */
+namespace bench
+{
+    class State
+    {
+    public:
+        explicit State(std::uint64_t iterations) : m_iterations(iterations) {}
+
+        // True until the requested number of iterations has run; the first call starts the clock
+        bool keepRunning();
+
+        // Excludes setup inside the loop from the timing
+        void pauseTiming();
+        void resumeTiming();
+
+        std::uint64_t iterations() const { return m_iterations; }
+
+        // Total over all iterations, for the bytes/s column
+        void setBytesProcessed(std::uint64_t bytes) { m_bytes = bytes; }
+        // Total over all iterations, for the items/s column
+        void setItemsProcessed(std::uint64_t items) { m_items = items; }
+        // Shown next to the results, e.g. the dataset
+        void setLabel(std::string label) { m_label = std::move(label); }
+
+        std::chrono::nanoseconds elapsed() const { return m_elapsed; }
+        std::uint64_t bytesProcessed() const { return m_bytes; }
+        std::uint64_t itemsProcessed() const { return m_items; }
+        const std::string &label() const { return m_label; }
+        std::uint64_t allocations() const { return m_allocations; }
+        std::uint64_t allocatedBytes() const { return m_allocatedBytes; }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        void start();
+        void stop();
+
+        std::uint64_t m_iterations;
+        std::uint64_t m_remaining = 0;
+        bool m_started = false;
+        bool m_paused = false;
+        Clock::time_point m_resumed;
+        std::chrono::nanoseconds m_elapsed{0};
+        std::uint64_t m_allocationsAtResume = 0;
+        std::uint64_t m_bytesAtResume = 0;
+        std::uint64_t m_allocations = 0;
+        std::uint64_t m_allocatedBytes = 0;
+        std::uint64_t m_bytes = 0;
+        std::uint64_t m_items = 0;
+        std::string m_label;
+    };
+
+    using Function = std::function<void(State &)>;
+
+    // Adds a benchmark to the registry; returns true so it can initialize a static
+    bool registerBenchmark(std::string name, Function function);
+
+    // Runs the registered benchmarks selected by the command line; returns the exit code
+    int runBenchmarks(int argc, char *argv[]);
+}
+
+#define FLASHFEED_BENCHMARK_CONCAT_(a, b) a##b
+#define FLASHFEED_BENCHMARK_NAME_(line) FLASHFEED_BENCHMARK_CONCAT_(flashfeedBenchmark_, line)
+#define FLASHFEED_BENCHMARK(function) \
+    static const bool FLASHFEED_BENCHMARK_NAME_(__LINE__) = bench::registerBenchmark(#function, function)
@@ -0,0 +1,157 @@
+#include "DataParser.hpp"
+#include "JsonBarParser.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Compares the streaming JsonBarParser against the previous nlohmann DOM
+// parser on synthetic Alpha Vantage intraday responses, fed whole and in
+// socket-sized pieces.
+
+namespace
+{
+    constexpr int ITERATIONS = 20;
+    constexpr std::size_t CHUNK_SIZE = 4096;
+
+    // Previous DataParserJsonAlphaAPI::parseData, kept here as the baseline
+    std::vector<MarketDataEntry> parseDom(const std::string &content)
+    {
+        std::vector<MarketDataEntry> data;
+        nlohmann::json jsonData = nlohmann::json::parse(content);
+        const std::vector<std::string> possibleKeys = {
+            "Time Series (1min)", "Time Series (5min)", "Time Series (15min)",
+            "Time Series (30min)", "Time Series (60min)", "Time Series (Daily)"};
+        std::string timeSeriesKey;
+        for (const auto &key : possibleKeys)
+        {
+            if (jsonData.contains(key))
+            {
+                timeSeriesKey = key;
+                break;
+            }
+        }
+        const auto &timeSeries = jsonData[timeSeriesKey];
+        data.reserve(timeSeries.size());
+        for (auto it = timeSeries.begin(); it != timeSeries.end(); ++it)
+        {
+            const auto &dataPoint = it.value();
+            Timestamp parsedTimestamp;
+            Timestamp::parse(it.key(), parsedTimestamp);
+            data.emplace_back(parsedTimestamp,
+                              std::stod(dataPoint.at("1. open").get<std::string>()),
+                              std::stod(dataPoint.at("2. high").get<std::string>()),
+                              std::stod(dataPoint.at("3. low").get<std::string>()),
+                              std::stod(dataPoint.at("4. close").get<std::string>()),
+                              std::stod(dataPoint.at("5. volume").get<std::string>()));
+        }
+        std::sort(data.begin(), data.end(), [](const MarketDataEntry &a, const MarketDataEntry &b)
+                  { return a.m_timestamp < b.m_timestamp; });
+        return data;
+    }
+
+    std::vector<MarketDataEntry> parseStreaming(const std::string &content, std::size_t chunkSize)
+    {
+        std::vector<MarketDataEntry> data;
+        JsonBarParser parser(data);
+        for (std::size_t offset = 0; offset < content.size(); offset += chunkSize)
+        {
+            parser.feed(std::string_view(content).substr(offset, chunkSize));
+        }
+        if (!parser.finish())
+        {
+            data.clear();
+        }
+        JsonBarParser::sortByTimestamp(data);
+        return data;
+    }
+
+    // Newest bar first, as the API sends them
+    std::string makeResponse(std::size_t bars)
+    {
+        std::string out = "{\n    \"Meta Data\": {\n        \"1. Information\": \"Intraday (1min) open, high, low, close prices and volume\",\n"
+                          "        \"2. Symbol\": \"IBM\",\n        \"3. Last Refreshed\": \"2025-01-16 19:59:00\"\n    },\n"
+                          "    \"Time Series (1min)\": {";
+        const std::int64_t last = 1737057540; // 2025-01-16 19:59:00 UTC
+        char line[320];
+        for (std::size_t i = 0; i < bars; ++i)
+        {
+            Timestamp ts((last - static_cast<std::int64_t>(i) * 60) * 1000000000LL);
+            const std::string text = ts.toString(Timestamp::EDGE_SEPARATOR);
+            double price = 180.0 + static_cast<double>(i % 500) * 0.01;
+            std::snprintf(line, sizeof(line),
+                          "%s\n        \"%s\": {\n            \"1. open\": \"%.4f\",\n            \"2. high\": \"%.4f\",\n"
+                          "            \"3. low\": \"%.4f\",\n            \"4. close\": \"%.4f\",\n            \"5. volume\": \"%zu\"\n        }",
+                          i ? "," : "", text.c_str(), price, price + 0.25, price - 0.25, price + 0.1, 100 + i);
+            out += line;
+        }
+        out += "\n    }\n}";
+        return out;
+    }
+
+    bool sameEntries(const std::vector<MarketDataEntry> &a, const std::vector<MarketDataEntry> &b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const MarketDataEntry &x, const MarketDataEntry &y)
+                          { return x.m_timestamp == y.m_timestamp && x.m_open == y.m_open && x.m_high == y.m_high &&
+                                   x.m_low == y.m_low && x.m_close == y.m_close && x.m_volume == y.m_volume; });
+    }
+
+    template <typename ParseFn>
+    double timeMegabytesPerSecond(ParseFn parse, const std::string &content, std::size_t &rows)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; ++i)
+        {
+            rows = parse(content).size();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return static_cast<double>(content.size()) * ITERATIONS / elapsed.count() / 1e6;
+    }
+}
+
+int main()
+{
+    // Keep per-parse log lines out of the timing output
+    Logger::getInstance().setLogFile("bench_json_log.txt");
+
+    std::cout << std::left << std::setw(10) << "bars" << std::setw(12) << "bytes" << std::right
+              << std::setw(12) << "DOM MB/s" << std::setw(14) << "stream MB/s" << std::setw(14) << "4K pcs MB/s"
+              << std::setw(10) << "speedup" << "\n";
+
+    for (std::size_t bars : {100, 1000, 20000})
+    {
+        const std::string content = makeResponse(bars);
+        const std::vector<MarketDataEntry> reference = parseDom(content);
+
+        // Every split point must give the same bars as the DOM parser
+        bool consistent = sameEntries(parseStreaming(content, content.size()), reference);
+        for (std::size_t chunk = 1; consistent && chunk <= 64 && bars <= 1000; ++chunk)
+        {
+            consistent = sameEntries(parseStreaming(content, chunk), reference);
+        }
+        if (!consistent)
+        {
+            std::cerr << "Streaming parser disagrees with the DOM parser at " << bars << " bars\n";
+            return 1;
+        }
+
+        std::size_t rows = 0;
+        double dom = timeMegabytesPerSecond(parseDom, content, rows);
+        double whole = timeMegabytesPerSecond([](const std::string &c)
+                                              { return parseStreaming(c, c.size()); },
+                                              content, rows);
+        double chunked = timeMegabytesPerSecond([](const std::string &c)
+                                                { return parseStreaming(c, CHUNK_SIZE); },
+                                                content, rows);
+
+        std::cout << std::left << std::setw(10) << bars << std::setw(12) << content.size() << std::right
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(12) << dom << std::setw(14) << whole << std::setw(14) << chunked
+                  << std::setw(9) << whole / dom << "x\n";
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "Logger.hpp"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures what one log call costs the calling thread, against the previous
+// synchronous logger (mutex, format and flush on every line), with one and
+// several threads logging at once. "log" calls build the message string
+// first; "macro" calls use FLASHFEED_LOG_INFO, which formats on the writer
+// thread and skips its arguments when the level is off.
+
+namespace
+{
+    constexpr int ROUNDS = 20;
+    constexpr std::size_t SUSTAINED_CALLS = 200000;
+
+    // Previous Logger::log, kept here as the baseline
+    class SyncLogger
+    {
+    public:
+        explicit SyncLogger(const std::string &path) : m_stream(path, std::ios::app) {}
+
+        void log(const std::string &message, Logger::LogLevel level)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            switch (level)
+            {
+            case Logger::LogLevel::INFO:
+                m_stream << "[INFO]";
+                break;
+            case Logger::LogLevel::WARNING:
+                m_stream << "[WARNING]";
+                break;
+            case Logger::LogLevel::ERROR:
+                m_stream << "[ERROR]";
+                break;
+            }
+            m_stream << message << std::endl;
+        }
+
+    private:
+        std::ofstream m_stream;
+        std::mutex m_mutex;
+    };
+
+    // Runs calls(thread, i) `count` times on each of `threads` threads; returns ns per call
+    template <typename Call>
+    double timePerCall(unsigned threads, std::size_t count, Call call)
+    {
+        std::vector<std::thread> workers;
+        std::vector<double> nanos(threads);
+        for (unsigned t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]
+                                 {
+                                     auto start = std::chrono::steady_clock::now();
+                                     for (std::size_t i = 0; i < count; ++i)
+                                     {
+                                         call(i);
+                                     }
+                                     std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+                                     nanos[t] = elapsed.count() / static_cast<double>(count); });
+        }
+        double total = 0;
+        for (unsigned t = 0; t < threads; ++t)
+        {
+            workers[t].join();
+            total += nanos[t];
+        }
+        return total / threads;
+    }
+
+    // A message built the way call sites build them
+    std::string message(std::size_t i)
+    {
+        return "Updated market data for AAPL: " + std::to_string(i) + " appended, 0 inserted, 0 replaced";
+    }
+}
+
+int main()
+{
+    Logger &logger = Logger::getInstance();
+    logger.setLogFile("bench_logger_log.txt");
+    SyncLogger sync("bench_logger_sync_log.txt");
+
+    std::cout << std::left << std::setw(9) << "threads" << std::right << std::setw(10) << "sync ns" << std::setw(10)
+              << "log ns" << std::setw(10) << "macro ns" << std::setw(15) << "sustained ns" << std::setw(10) << "dropped"
+              << std::setw(10) << "log off" << std::setw(11) << "macro off" << "\n";
+
+    for (unsigned threads : {1u, 2u, 4u})
+    {
+        // Bursts that fit in the ring: the cost a caller sees when the writer keeps up
+        const std::size_t burst = Logger::CAPACITY / 2 / threads;
+        double syncNs = 0;
+        double burstNs = 0;
+        double macroNs = 0;
+        for (int round = 0; round < ROUNDS; ++round)
+        {
+            syncNs += timePerCall(threads, burst, [&sync](std::size_t i)
+                                  { sync.log(message(i), Logger::LogLevel::INFO); });
+            burstNs += timePerCall(threads, burst, [&logger](std::size_t i)
+                                   { logger.log(message(i), Logger::LogLevel::INFO); });
+            logger.flush();
+            macroNs += timePerCall(threads, burst, [](std::size_t i)
+                                   { FLASHFEED_LOG_INFO("Updated market data for {}: {} appended, 0 inserted, 0 replaced", "AAPL", i); });
+            logger.flush();
+        }
+
+        // Logging flat out, faster than any file can take it; excess messages are dropped
+        const std::uint64_t droppedBefore = logger.stats().dropped;
+        double sustainedNs = timePerCall(threads, SUSTAINED_CALLS, [&logger](std::size_t i)
+                                         { logger.log(message(i), Logger::LogLevel::INFO); });
+        logger.flush();
+        const std::uint64_t dropped = logger.stats().dropped - droppedBefore;
+
+        // Below the run-time level: log() still gets a built message to discard, the macro builds nothing
+        logger.setLevel(Logger::LogLevel::WARNING);
+        double logOffNs = timePerCall(threads, SUSTAINED_CALLS, [&logger](std::size_t i)
+                                      { logger.log(message(i), Logger::LogLevel::INFO); });
+        double macroOffNs = timePerCall(threads, SUSTAINED_CALLS, [](std::size_t i)
+                                        { FLASHFEED_LOG_INFO("{}", message(i)); });
+        logger.setLevel(Logger::LogLevel::INFO);
+
+        std::cout << std::left << std::setw(9) << threads << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << syncNs / ROUNDS << std::setw(10) << burstNs / ROUNDS << std::setw(10) << macroNs / ROUNDS
+                  << std::setw(15) << sustainedNs << std::setw(10) << dropped << std::setw(10) << logOffNs
+                  << std::setw(11) << macroOffNs << "\n";
+    }
+
+    Logger::Stats stats = logger.stats();
+    std::cout << "logged " << stats.logged << ", written " << stats.written << ", dropped " << stats.dropped
+              << ", stalls " << stats.stalls << "\n";
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "FetchScheduler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Sequential upstream GETs with connection reuse off (a new connection, DNS
+// lookup and full TLS handshake per request) and on (keep-alive pool, cached
+// DNS, TLS session resumption). Prints the per-request latency and the
+// connection counters of each run.
+//
+// Usage: BenchUpstreamFetch [host] [port] [tls 0|1] [requests] [target]
+// Run TestUpstreamApi with a delay of 0 as the upstream to measure the
+// connection overhead alone.
+
+namespace net = boost::asio;
+
+namespace
+{
+    double percentile(std::vector<double> samples, double p)
+    {
+        if (samples.empty())
+        {
+            return 0.0;
+        }
+        std::sort(samples.begin(), samples.end());
+        std::size_t index = static_cast<std::size_t>(p * (samples.size() - 1));
+        return samples[index];
+    }
+
+    void runFetches(const std::string &host, FetchOptions options, std::size_t count, const std::string &target)
+    {
+        net::io_context ioc(1);
+        UpstreamConnectionPool pool(ioc, host, options);
+
+        std::vector<double> micros;
+        micros.reserve(count);
+        std::size_t failed = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            bool ok = false;
+            auto start = std::chrono::steady_clock::now();
+            auto request = std::make_shared<UpstreamRequest>(pool, target);
+            request->start([&ok](UpstreamResult result)
+                           { ok = result.ok; });
+            ioc.restart();
+            ioc.run();
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            micros.push_back(elapsed.count());
+            failed += ok ? 0 : 1;
+        }
+
+        std::cout << std::left << std::setw(12) << (options.reuseConnections ? "reuse" : "no reuse") << std::right
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(12) << percentile(micros, 0.50) << std::setw(12) << percentile(micros, 0.99)
+                  << std::setw(12) << percentile(micros, 1.0) << std::setw(10) << failed << "\n"
+                  << "            " << pool.stats().summary() << "\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const std::string host = argc > 1 ? argv[1] : "127.0.0.1";
+    FetchOptions options;
+    options.port = argc > 2 ? argv[2] : "8443";
+    options.useTls = argc > 3 ? std::string(argv[3]) != "0" : false;
+    const std::size_t count = argc > 4 ? std::stoul(argv[4]) : 200;
+    const std::string target = argc > 5 ? argv[5] : "/query?function=TIME_SERIES_INTRADAY&symbol=BENCH&interval=1min&apikey=demo";
+
+    std::cout << count << " sequential GETs against " << (options.useTls ? "https://" : "http://") << host << ":" << options.port << "\n";
+    std::cout << std::left << std::setw(12) << "mode" << std::right << std::setw(12) << "p50 us" << std::setw(12) << "p99 us"
+              << std::setw(12) << "max us" << std::setw(10) << "failed" << "\n";
+
+    options.reuseConnections = false;
+    runFetches(host, options, count, target);
+    options.reuseConnections = true;
+    runFetches(host, options, count, target);
+    return 0;
+}
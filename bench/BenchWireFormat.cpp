@@ -0,0 +1,118 @@
+#include "DataParser.hpp"
+#include "Logger.hpp"
+#include "WireProtocol.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+// Compares the JSON payloads sent after DATA_SIZE/SNAPSHOT/UPDATE headers
+// against the packed records used after "HELLO BINARY".
+
+using json = nlohmann::json;
+
+namespace
+{
+    constexpr std::size_t ROWS = 100000;
+    constexpr int ITERATIONS = 20;
+
+    std::vector<MarketDataEntry> makeRows(std::size_t count)
+    {
+        std::mt19937_64 rng(42);
+        std::uniform_real_distribution<double> step(-0.5, 0.5);
+        std::uniform_real_distribution<double> volume(1000.0, 50000.0);
+
+        std::vector<MarketDataEntry> rows;
+        rows.reserve(count);
+        Timestamp start;
+        Timestamp::parse("2025-01-16T09:00:00", start);
+        double price = 150.0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            double open = price;
+            price += step(rng);
+            rows.emplace_back(Timestamp(start.m_nanos + static_cast<std::int64_t>(i) * 60'000'000'000LL),
+                              open, std::max(open, price) + 0.1, std::min(open, price) - 0.1, price, std::round(volume(rng)));
+        }
+        return rows;
+    }
+
+    template <typename Fn>
+    double secondsPerRun(Fn fn)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; ++i)
+        {
+            fn();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / ITERATIONS;
+    }
+
+    bool sameEntries(const std::vector<MarketDataEntry> &a, const std::vector<MarketDataEntry> &b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const MarketDataEntry &x, const MarketDataEntry &y)
+                          { return x.m_timestamp == y.m_timestamp && x.m_open == y.m_open && x.m_high == y.m_high &&
+                                   x.m_low == y.m_low && x.m_close == y.m_close && x.m_volume == y.m_volume; });
+    }
+
+    void report(const char *name, std::size_t bytes, double encodeSeconds, double decodeSeconds)
+    {
+        std::cout << std::setw(7) << name << ": " << std::setw(10) << bytes << " bytes ("
+                  << static_cast<double>(bytes) / ROWS << " B/row), encode "
+                  << ROWS / encodeSeconds / 1e6 << " Mrows/s, decode "
+                  << ROWS / decodeSeconds / 1e6 << " Mrows/s" << std::endl;
+    }
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("bench_log.txt");
+    const std::vector<MarketDataEntry> rows = makeRows(ROWS);
+
+    std::string jsonPayload = json(rows).dump();
+    std::string binaryPayload;
+    WireProtocol::encodeBinaryRecords(rows, binaryPayload);
+
+    std::vector<MarketDataEntry> fromJson = json::parse(jsonPayload).get<std::vector<MarketDataEntry>>();
+    std::vector<MarketDataEntry> fromBinary;
+    if (!WireProtocol::decodeBinaryRecords(binaryPayload, fromBinary) || !sameEntries(rows, fromBinary) ||
+        fromJson.size() != rows.size())
+    {
+        std::cerr << "Round trip mismatch" << std::endl;
+        return 1;
+    }
+
+    double jsonEncode = secondsPerRun([&]
+                                      { jsonPayload = json(rows).dump(); });
+    double jsonDecode = secondsPerRun([&]
+                                      { fromJson = json::parse(jsonPayload).get<std::vector<MarketDataEntry>>(); });
+
+    double binaryEncode = secondsPerRun([&]
+                                        { binaryPayload.clear(); WireProtocol::encodeBinaryRecords(rows, binaryPayload); });
+    double binaryDecode = secondsPerRun([&]
+                                        { fromBinary.clear(); WireProtocol::decodeBinaryRecords(binaryPayload, fromBinary); });
+
+    // The per-record path is what big-endian hosts and the server's columnar snapshots use
+    std::string recordPayload;
+    double recordEncode = secondsPerRun([&]
+                                        {
+        recordPayload.clear();
+        recordPayload.reserve(rows.size() * WireProtocol::BINARY_RECORD_SIZE);
+        for (const auto &entry : rows)
+        {
+            WireProtocol::appendBinaryRecord(recordPayload, entry);
+        } });
+
+    std::cout << std::fixed << std::setprecision(1) << ROWS << " rows" << std::endl;
+    report("json", jsonPayload.size(), jsonEncode, jsonDecode);
+    report("binary", binaryPayload.size(), binaryEncode, binaryDecode);
+    report("records", recordPayload.size(), recordEncode, binaryDecode);
+    std::cout << "binary vs json: " << static_cast<double>(jsonPayload.size()) / binaryPayload.size() << "x smaller, encode "
+              << jsonEncode / binaryEncode << "x, decode " << jsonDecode / binaryDecode << "x faster" << std::endl;
+    return 0;
+}
@@ -0,0 +1,336 @@
+#include "BenchHarness.hpp"
+#include "DataParser.hpp"
+#include "JsonBarParser.hpp"
+#include "Logger.hpp"
+#include "MarketDataServer.hpp"
+#include "SymbolTable.hpp"
+#include "WireProtocol.hpp"
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The flashfeed_bench suite: the hot paths of the server and client, run on
+// the per-second bars in data/. Usage is described in BenchHarness.hpp.
+
+using json = nlohmann::json;
+
+namespace
+{
+    const std::string CSV_PATH = std::string(DATA_FOLDER) + "/market_data_AAPL.csv";
+    constexpr std::size_t FANOUT_SUBSCRIBERS = 100;
+
+    // The AAPL bars, parsed once
+    const std::vector<MarketDataEntry> &dataset()
+    {
+        static const std::vector<MarketDataEntry> rows = []
+        {
+            auto parser = ParserFactory::createCSVParser(CSV_PATH);
+            if (!parser->parseData() || parser->getData().empty())
+            {
+                throw std::runtime_error("Cannot load " + CSV_PATH);
+            }
+            return parser->getData();
+        }();
+        return rows;
+    }
+
+    // The dataset as an Alpha Vantage intraday response, newest bar first like the API sends
+    const std::string &alphaVantageResponse()
+    {
+        static const std::string response = []
+        {
+            const std::vector<MarketDataEntry> &rows = dataset();
+            std::string out = "{\n    \"Meta Data\": {\n        \"1. Information\": \"Intraday (1min) open, high, low, close prices and volume\",\n"
+                              "        \"2. Symbol\": \"AAPL\"\n    },\n    \"Time Series (1min)\": {";
+            char line[320];
+            for (std::size_t i = rows.size(); i-- > 0;)
+            {
+                const MarketDataEntry &row = rows[i];
+                const std::string timestamp = row.m_timestamp.toString(Timestamp::EDGE_SEPARATOR);
+                std::snprintf(line, sizeof(line),
+                              "%s\n        \"%s\": {\n            \"1. open\": \"%.4f\",\n            \"2. high\": \"%.4f\",\n"
+                              "            \"3. low\": \"%.4f\",\n            \"4. close\": \"%.4f\",\n            \"5. volume\": \"%.0f\"\n        }",
+                              i + 1 == rows.size() ? "" : ",", timestamp.c_str(), row.m_open, row.m_high, row.m_low, row.m_close, row.m_volume);
+                out += line;
+            }
+            out += "\n    }\n}";
+            return out;
+        }();
+        return response;
+    }
+
+    // Reads and discards until the socket is closed
+    void drainClient(tcp::socket &client, std::array<char, 65536> &buffer)
+    {
+        client.async_read_some(net::buffer(buffer), [&client, &buffer](const boost::system::error_code &ec, std::size_t)
+                               {
+                                   if (!ec)
+                                   {
+                                       drainClient(client, buffer);
+                                   }
+                               });
+    }
+
+    // The bar after the dataset's last, i seconds on
+    MarketDataEntry nextBar(std::size_t i)
+    {
+        MarketDataEntry bar = dataset().back();
+        bar.m_timestamp = Timestamp(bar.m_timestamp.m_nanos + static_cast<std::int64_t>(i + 1) * 1'000'000'000LL);
+        bar.m_close += static_cast<double>(i % 100) * 0.01;
+        return bar;
+    }
+
+    void csvParse(bench::State &state)
+    {
+        std::size_t rows = 0;
+        while (state.keepRunning())
+        {
+            auto parser = ParserFactory::createCSVParser(CSV_PATH);
+            parser->parseData();
+            rows = parser->getData().size();
+        }
+        state.setBytesProcessed(state.iterations() * std::filesystem::file_size(CSV_PATH));
+        state.setItemsProcessed(state.iterations() * rows);
+        state.setLabel("market_data_AAPL.csv");
+    }
+    FLASHFEED_BENCHMARK(csvParse);
+
+    void jsonParse(bench::State &state)
+    {
+        const std::string &response = alphaVantageResponse();
+        std::vector<MarketDataEntry> bars;
+        while (state.keepRunning())
+        {
+            bars.clear();
+            JsonBarParser parser(bars);
+            parser.feed(response);
+            parser.finish();
+            JsonBarParser::sortByTimestamp(bars);
+        }
+        state.setBytesProcessed(state.iterations() * response.size());
+        state.setItemsProcessed(state.iterations() * bars.size());
+        state.setLabel("AAPL as an API response");
+    }
+    FLASHFEED_BENCHMARK(jsonParse);
+
+    // A snapshot frame's payload: the whole history
+    void jsonSerializeHistory(bench::State &state)
+    {
+        const ColumnarSeries series(dataset());
+        std::size_t bytes = 0;
+        while (state.keepRunning())
+        {
+            bytes = json(series).dump().size();
+        }
+        state.setBytesProcessed(state.iterations() * bytes);
+        state.setItemsProcessed(state.iterations() * series.size());
+    }
+    FLASHFEED_BENCHMARK(jsonSerializeHistory);
+
+    // An UPDATE frame for one new bar
+    void jsonSerializeUpdate(bench::State &state)
+    {
+        const std::vector<MarketDataEntry> rows = {nextBar(0)};
+        std::size_t bytes = 0;
+        while (state.keepRunning())
+        {
+            std::string payload = json(rows).dump();
+            std::string header = WireProtocol::makeUpdateHeader("AAPL", 1, 2, rows.front().m_timestamp, payload.size());
+            bytes = header.size() + payload.size();
+        }
+        state.setBytesProcessed(state.iterations() * bytes);
+    }
+    FLASHFEED_BENCHMARK(jsonSerializeUpdate);
+
+    // One new bar merged into the full history, as each live tick does
+    void cacheUpdateAppend(bench::State &state)
+    {
+        constexpr std::uint64_t RESET_EVERY = 1024; // Keeps the series near the dataset's size
+        SymbolTable symbols;
+        const SymbolId id = *symbols.intern("AAPL");
+        std::unique_ptr<MarketDataServer::DataCache> cache;
+        std::uint64_t i = 0;
+        while (state.keepRunning())
+        {
+            if (i % RESET_EVERY == 0)
+            {
+                state.pauseTiming();
+                cache = std::make_unique<MarketDataServer::DataCache>(symbols);
+                cache->updateData(id, dataset());
+                state.resumeTiming();
+            }
+            cache->updateData(id, {nextBar(i % RESET_EVERY)});
+            ++i;
+        }
+        state.setItemsProcessed(state.iterations());
+        state.setLabel(std::to_string(dataset().size()) + " bars");
+    }
+    FLASHFEED_BENCHMARK(cacheUpdateAppend);
+
+    // A refresh that returns the last 100 bars unchanged
+    void cacheUpdateUnchanged(bench::State &state)
+    {
+        SymbolTable symbols;
+        const SymbolId id = *symbols.intern("AAPL");
+        MarketDataServer::DataCache cache(symbols);
+        cache.updateData(id, dataset());
+        const std::vector<MarketDataEntry> refresh(dataset().end() - 100, dataset().end());
+        while (state.keepRunning())
+        {
+            cache.updateData(id, refresh);
+        }
+        state.setItemsProcessed(state.iterations() * refresh.size());
+    }
+    FLASHFEED_BENCHMARK(cacheUpdateUnchanged);
+
+    void cacheGetById(bench::State &state)
+    {
+        SymbolTable symbols;
+        const SymbolId id = *symbols.intern("AAPL");
+        MarketDataServer::DataCache cache(symbols);
+        cache.updateData(id, dataset());
+        std::size_t rows = 0;
+        while (state.keepRunning())
+        {
+            rows += cache.getSeries(id)->size();
+        }
+        state.setLabel(rows ? "" : "empty");
+    }
+    FLASHFEED_BENCHMARK(cacheGetById);
+
+    void cacheGetByName(bench::State &state)
+    {
+        SymbolTable symbols;
+        const SymbolId id = *symbols.intern("AAPL");
+        MarketDataServer::DataCache cache(symbols);
+        cache.updateData(id, dataset());
+        const std::string name = "AAPL";
+        std::size_t rows = 0;
+        while (state.keepRunning())
+        {
+            rows += cache.getSeries(name)->size();
+        }
+        state.setLabel(rows ? "" : "empty");
+    }
+    FLASHFEED_BENCHMARK(cacheGetByName);
+
+    /**
+     * One update published to FANOUT_SUBSCRIBERS sessions connected over
+     * loopback, as PublishUpdate does it: the frame is encoded once and queued
+     * on every subscriber. The time is the publishing thread's; the sessions'
+     * writes run on an IO thread, where the client ends read and discard.
+     */
+    void fanoutUpdate(bench::State &state)
+    {
+        net::io_context ioc;
+        auto work = net::make_work_guard(ioc);
+        tcp::acceptor acceptor(ioc, tcp::endpoint(net::ip::address_v4::loopback(), 0));
+
+        MarketDataServer::SubscriptionManager subscriptions;
+        std::vector<MarketDataServer::SessionPtr> sessions;
+        std::vector<std::unique_ptr<tcp::socket>> clients;
+        std::vector<std::unique_ptr<std::array<char, 65536>>> buffers;
+        const SymbolId id = 0;
+        for (std::size_t i = 0; i < FANOUT_SUBSCRIBERS; ++i)
+        {
+            auto client = std::make_unique<tcp::socket>(ioc);
+            client->connect(acceptor.local_endpoint());
+            tcp::socket server = acceptor.accept();
+            auto session = std::make_shared<MarketDataServer::Session>(std::move(server), MarketDataServer::SendQueueOptions{});
+            subscriptions.addSubscription(id, session);
+            sessions.push_back(std::move(session));
+            clients.push_back(std::move(client));
+            buffers.push_back(std::make_unique<std::array<char, 65536>>());
+        }
+        for (std::size_t i = 0; i < clients.size(); ++i)
+        {
+            drainClient(*clients[i], *buffers[i]);
+        }
+        std::thread io([&ioc]
+                       { ioc.run(); });
+
+        std::uint64_t sequence = 1;
+        while (state.keepRunning())
+        {
+            const std::vector<MarketDataEntry> rows = {nextBar(sequence % 1000)};
+            auto frame = std::make_shared<WireProtocol::EncodedFrame>();
+            frame->payload = json(rows).dump();
+            frame->header = WireProtocol::makeUpdateHeader("AAPL", sequence, sequence + 1, rows.front().m_timestamp,
+                                                           frame->payload.size());
+            frame->symbol = "AAPL";
+            ++sequence;
+            const WireProtocol::SharedFrame shared = std::move(frame);
+            for (const auto &session : subscriptions.getSubscribers(id))
+            {
+                session->send(shared);
+            }
+        }
+
+        std::uint64_t dropped = 0;
+        for (const auto &session : sessions)
+        {
+            dropped += session->sendQueueStats().framesDropped;
+            session->cancel();
+        }
+        // The client sockets belong to the IO thread, so they are closed there; run()
+        // returns once every session and read has wound down
+        net::post(ioc, [&clients]
+                  {
+                      for (const auto &client : clients)
+                      {
+                          boost::system::error_code ignored;
+                          client->close(ignored);
+                      }
+                  });
+        work.reset();
+        io.join();
+
+        state.setItemsProcessed(state.iterations() * FANOUT_SUBSCRIBERS);
+        state.setLabel(std::to_string(FANOUT_SUBSCRIBERS) + " subscribers, " + std::to_string(dropped) + " frames dropped");
+    }
+    FLASHFEED_BENCHMARK(fanoutUpdate);
+
+    // A binary snapshot payload, as the client decodes it
+    void wireDecodeBinary(bench::State &state)
+    {
+        std::string payload;
+        WireProtocol::encodeBinaryRecords(dataset(), payload);
+        std::vector<MarketDataEntry> rows;
+        while (state.keepRunning())
+        {
+            rows.clear();
+            WireProtocol::decodeBinaryRecords(payload, rows);
+        }
+        state.setBytesProcessed(state.iterations() * payload.size());
+        state.setItemsProcessed(state.iterations() * rows.size());
+    }
+    FLASHFEED_BENCHMARK(wireDecodeBinary);
+
+    // A JSON snapshot payload, as the client decodes it
+    void wireDecodeJson(bench::State &state)
+    {
+        const std::string payload = json(dataset()).dump();
+        std::size_t count = 0;
+        while (state.keepRunning())
+        {
+            count = json::parse(payload).get<std::vector<MarketDataEntry>>().size();
+        }
+        state.setBytesProcessed(state.iterations() * payload.size());
+        state.setItemsProcessed(state.iterations() * count);
+    }
+    FLASHFEED_BENCHMARK(wireDecodeJson);
+}
+
+int main(int argc, char *argv[])
+{
+    // Per-call INFO lines are part of what the server pays, but not what is measured here
+    Logger::getInstance().setLogFile("flashfeed_bench_log.txt");
+    Logger::getInstance().setLevel(Logger::LogLevel::WARNING);
+    return bench::runBenchmarks(argc, argv);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "DataParser.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Parsed CSV fallback files, kept in memory between refreshes.
+ *
+ * A file is parsed the first time it is asked for and again only after its
+ * size, modification time or inode changes, so a fallback that finds the
+ * file untouched costs one stat() instead of a full read and parse. A file
+ * replaced by rename is caught through the inode. If the file disappears,
+ * the bars parsed last keep being served.
+ *
+ * Files are read into memory rather than mapped before parsing: these are
+ * the files people edit in place, and a mapped file truncated mid-parse
+ * would take the server down with SIGBUS.
+ *
+ * Thread-safe.
+ */
+class CsvFallbackCache
+{
+public:
+    struct Entry
+    {
+        std::shared_ptr<const std::vector<MarketDataEntry>> bars; // Null if the file could not be parsed
+        std::uint64_t version = 0;                                // Changes every time the file is parsed again
+    };
+
+    Entry load(const std::string &path);
+
+    // Number of times a file was actually read and parsed
+    std::size_t parses() const;
+
+private:
+    struct FileStamp
+    {
+        std::uint64_t device = 0;
+        std::uint64_t inode = 0;
+        std::uint64_t size = 0;
+        std::int64_t modifiedNs = 0;
+
+        bool operator==(const FileStamp &other) const
+        {
+            return device == other.device && inode == other.inode && size == other.size && modifiedNs == other.modifiedNs;
+        }
+    };
+
+    struct CachedFile
+    {
+        FileStamp stamp;
+        Entry entry;
+    };
+
+    static bool stampFile(const std::string &path, FileStamp &stamp);
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, CachedFile> m_files;
+    std::uint64_t m_nextVersion = 1;
+    std::size_t m_parses = 0;
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Structural indexing for CSV buffers.
+ *
+ * One sweep over the buffer records the offset of every ',' and '\n', plus
+ * where each row ends in that list, so the row parser never has to search
+ * for separators itself. The sweep uses AVX2 or SSE2 when the CPU has them
+ * and a scalar loop otherwise.
+ */
+namespace CsvScanner
+{
+    enum class Kernel
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    struct StructuralIndex
+    {
+        // Byte offsets of every ',' and '\n', in buffer order
+        std::vector<std::uint32_t> delimiters;
+        // For each row, one past the index of its last delimiter in `delimiters`.
+        // Row i owns delimiters [rowEnds[i - 1], rowEnds[i]). An unterminated
+        // last row owns the delimiters after the final '\n' and ends at the buffer end.
+        std::vector<std::uint32_t> rowEnds;
+
+        void clear()
+        {
+            delimiters.clear();
+            rowEnds.clear();
+        }
+    };
+
+    // Offsets are 32-bit, so a single index covers buffers up to this size
+    constexpr std::size_t MAX_INDEXED_BYTES = UINT32_MAX;
+
+    // Fastest kernel supported by the running CPU
+    Kernel bestKernel();
+    bool isKernelSupported(Kernel kernel);
+    const char *kernelName(Kernel kernel);
+
+    // Rebuilds index for buffer. Returns false if the buffer is too large to index
+    // or the requested kernel is not supported on this CPU.
+    bool buildIndex(std::string_view buffer, StructuralIndex &index);
+    bool buildIndex(std::string_view buffer, StructuralIndex &index, Kernel kernel);
+}
@@ -5,14 +5,18 @@
 #include <cstdint>
 #include <string>
 #include <memory> 
+#include <string_view>
+#include <type_traits>
 #include <nlohmann/json.hpp>
 #include "Logger.hpp"
+#include "MappedFile.hpp"
+#include "Timestamp.hpp"
 
 
 
 struct MarketDataEntry
 {
-    std::string m_timestamp;
+    Timestamp m_timestamp;
     double m_open;
     double m_high;
     double m_low;
@@ -20,16 +24,17 @@ struct MarketDataEntry
     double m_volume;
 
     MarketDataEntry() = default;
-    MarketDataEntry(const std::string &timestamp, double open, double high, double low, double close, double volume)
+    MarketDataEntry(Timestamp timestamp, double open, double high, double low, double close, double volume)
         : m_timestamp(timestamp), m_open(open), m_high(high), m_low(low), m_close(close), m_volume(volume) {}
-
-    // Virutal destrocutor for proper clensing out
-    ~MarketDataEntry() = default;
 };
 
+// Entries are copied in bulk between parsers, the cache and the wire, so keep them plain data
+static_assert(std::is_trivially_copyable_v<MarketDataEntry>, "MarketDataEntry must stay trivially copyable");
+static_assert(std::is_standard_layout_v<MarketDataEntry>, "MarketDataEntry must stay standard layout");
+
 inline void to_json(nlohmann::json& j, const MarketDataEntry& entry) {
     j = nlohmann::json{
-        {"timestamp", entry.m_timestamp},
+        {"timestamp", entry.m_timestamp.toString(Timestamp::EDGE_SEPARATOR)},
         {"open", entry.m_open},
         {"high", entry.m_high},
         {"low", entry.m_low},
@@ -40,19 +45,25 @@ inline void to_json(nlohmann::json& j, const MarketDataEntry& entry) {
 
 inline void from_json(const nlohmann::json& j, MarketDataEntry& entry) {
     try {
-        j.at("timestamp").get_to(entry.m_timestamp);
+        const std::string& timestamp = j.at("timestamp").get_ref<const std::string&>();
+        if (!Timestamp::parse(timestamp, entry.m_timestamp)) {
+            throw std::invalid_argument("Invalid timestamp: " + timestamp);
+        }
         j.at("open").get_to(entry.m_open);
         j.at("high").get_to(entry.m_high);
         j.at("low").get_to(entry.m_low);
         j.at("close").get_to(entry.m_close);
         j.at("volume").get_to(entry.m_volume);
     } catch (const nlohmann::json::exception& e) {
-        Logger::getInstance().log("JSON parsing error for MarketDataEntry: " + std::string(e.what()), Logger::LogLevel::ERROR);
+        FLASHFEED_LOG_ERROR("JSON parsing error for MarketDataEntry: {}", e.what());
         throw; // Re-throw the json exception
     }
 }
 
 
+// Parses one "timestamp,open,high,low,close,volume" CSV row in place. Returns false on a malformed row.
+bool parseCSVRow(std::string_view line, MarketDataEntry &entry);
+
 class IDataParser
 {
 public:
@@ -67,22 +78,27 @@ public:
     IDataParser &operator=(const IDataParser &) = delete;
 };
 
+// Parses a CSV file in place. Mode::Copy reads it into memory first, for files
+// that may be edited while they are being parsed.
 class DataParserCSVAlphaAPI : public IDataParser
 {
 public:
-    explicit DataParserCSVAlphaAPI(const std::string &CSVPath);
+    explicit DataParserCSVAlphaAPI(const std::string &CSVPath, MappedFile::Mode mode = MappedFile::Mode::Map);
     virtual const std::vector<MarketDataEntry> &getData() const override;
     virtual bool parseData() override;
 
 private:
     std::string m_CSVPath;
+    MappedFile::Mode m_mode;
     std::vector<MarketDataEntry> m_data;
 };
 
+// Parses an API response held by the parser; move the body in to avoid a copy.
+// To parse a buffer in place, or as it arrives, feed it to a JsonBarParser instead.
 class DataParserJsonAlphaAPI : public IDataParser
 {
 public:
-    explicit DataParserJsonAlphaAPI(const std::string &jsonContent);
+    explicit DataParserJsonAlphaAPI(std::string jsonContent);
     virtual const std::vector<MarketDataEntry> &getData() const override;
     virtual bool parseData() override;
 
@@ -101,8 +117,8 @@ public:
     static std::unique_ptr<IDataParser> createParser(const std::string &source);
 
     // Specific factory methods
-    static std::unique_ptr<IDataParser> createCSVParser(const std::string &filePath);
-    static std::unique_ptr<IDataParser> createJSONParser(const std::string &jsonContent);
+    static std::unique_ptr<IDataParser> createCSVParser(const std::string &filePath, MappedFile::Mode mode = MappedFile::Mode::Map);
+    static std::unique_ptr<IDataParser> createJSONParser(std::string jsonContent);
 };
 
 namespace ParsingFunctions
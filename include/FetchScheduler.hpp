@@ -0,0 +1,336 @@
+#pragma once
+#include <utility> // Before Asio: Boost 1.74's awaitable.hpp uses std::exchange without including it
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast.hpp>
+#include <boost/beast/ssl.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// How upstream HTTP requests are made
+struct FetchOptions
+{
+    std::string port = "443";
+    bool useTls = true;                // Off for a plain-HTTP stand-in server
+    std::size_t maxConcurrent = 4;     // Requests in flight at once
+    std::chrono::seconds timeout{15};  // Whole request: resolve, connect, handshake, write and read
+    bool reuseConnections = true;      // Keep-alive connections, TLS session resumption and cached DNS results
+    std::chrono::seconds dnsCacheTtl{300};
+    bool conditionalRequests = true;   // Send If-None-Match / If-Modified-Since when the upstream gave validators
+};
+
+// TLS 1.2 client context loaded with the system's default CA paths
+std::shared_ptr<boost::asio::ssl::context> CreateClientTlsContext();
+
+// Upstream connection counters. Only touched on the pool's io_context thread.
+struct UpstreamStats
+{
+    std::size_t requests = 0; // Completed, successfully or not
+    std::size_t failures = 0;
+    std::size_t dnsLookups = 0;
+    std::size_t connects = 0;
+    std::size_t fullHandshakes = 0;
+    std::size_t resumedHandshakes = 0; // Abbreviated handshakes from a cached TLS session
+    std::size_t reusedConnections = 0; // Requests sent on an idle keep-alive connection
+    std::size_t retries = 0;           // Reused connections found closed, request resent on a new one
+    std::size_t notModified = 0;       // 304 answers to conditional requests
+    std::size_t unchanged = 0;         // A 304 or a body identical to the job's previous one
+    std::chrono::nanoseconds totalLatency{0};
+    std::chrono::nanoseconds maxLatency{0};
+
+    std::string summary() const;
+};
+
+/**
+ * @brief Connections to one upstream host, kept for reuse between requests.
+ *
+ * Holds idle keep-alive streams, the last resolved endpoints and the last
+ * TLS session, so that a request normally skips DNS, connect and the full
+ * handshake. With reuseConnections off every request opens, resolves and
+ * handshakes from scratch.
+ *
+ * Not thread-safe; used from the thread running its io_context.
+ */
+class UpstreamConnectionPool
+{
+public:
+    using Stream = boost::beast::ssl_stream<boost::beast::tcp_stream>;
+    using Endpoints = boost::asio::ip::tcp::resolver::results_type;
+
+    UpstreamConnectionPool(boost::asio::io_context &ioc, std::string host, FetchOptions options);
+    ~UpstreamConnectionPool();
+
+    UpstreamConnectionPool(const UpstreamConnectionPool &) = delete;
+    UpstreamConnectionPool &operator=(const UpstreamConnectionPool &) = delete;
+
+    // An idle connection, or null if a new one has to be opened
+    std::unique_ptr<Stream> acquire();
+    // Keeps a connection that finished a keep-alive exchange, if there is room
+    void release(std::unique_ptr<Stream> stream);
+    // A new unconnected stream, set up to resume the cached TLS session
+    std::unique_ptr<Stream> newStream();
+    void closeIdle();
+
+    // Cached resolver results, or null once they have expired
+    const Endpoints *endpoints() const;
+    void storeEndpoints(Endpoints endpoints);
+    void forgetEndpoints();
+
+    // Remembers the session of a completed handshake for the next new connection
+    void storeSession(Stream &stream);
+
+    boost::asio::io_context &context() { return m_ioc; }
+    const std::string &host() const { return m_host; }
+    const FetchOptions &options() const { return m_options; }
+    UpstreamStats &stats() { return m_stats; }
+    const UpstreamStats &stats() const { return m_stats; }
+
+private:
+    boost::asio::io_context &m_ioc;
+    std::string m_host;
+    FetchOptions m_options;
+    std::shared_ptr<boost::asio::ssl::context> m_tls;
+
+    std::vector<std::unique_ptr<Stream>> m_idle;
+    Endpoints m_endpoints;
+    std::chrono::steady_clock::time_point m_endpointsExpiry;
+    SSL_SESSION *m_session = nullptr; // Owned; freed when replaced
+    UpstreamStats m_stats;
+};
+
+/**
+ * @brief Beast body for upstream responses.
+ *
+ * Without a sink the body is collected into text, like string_body. With
+ * one, the body of a 200 response is handed to the sink as each read
+ * completes instead of being stored; the sink returns false to abort the
+ * read. Other statuses are always collected, for the log.
+ */
+struct UpstreamBody
+{
+    using Sink = std::function<bool(std::string_view piece)>;
+
+    struct value_type
+    {
+        std::string text;
+        Sink sink;
+        std::uint64_t hash = FNV_OFFSET; // FNV-1a of every byte read, streamed or not
+    };
+
+    static constexpr std::uint64_t FNV_OFFSET = 14695981039346656037ull;
+    static constexpr std::uint64_t FNV_PRIME = 1099511628211ull;
+
+    class reader
+    {
+    public:
+        template <bool isRequest, class Fields>
+        reader(boost::beast::http::header<isRequest, Fields> &header, value_type &body)
+            : m_body(body)
+        {
+            if constexpr (!isRequest)
+            {
+                m_streaming = body.sink && header.result() == boost::beast::http::status::ok;
+            }
+        }
+
+        void init(const boost::optional<std::uint64_t> &length, boost::beast::error_code &ec)
+        {
+            if (length && !m_streaming)
+            {
+                m_body.text.reserve(static_cast<std::size_t>(*length));
+            }
+            ec = {};
+        }
+
+        template <class ConstBufferSequence>
+        std::size_t put(const ConstBufferSequence &buffers, boost::beast::error_code &ec)
+        {
+            std::size_t bytes = 0;
+            for (auto it = boost::asio::buffer_sequence_begin(buffers); it != boost::asio::buffer_sequence_end(buffers); ++it)
+            {
+                boost::asio::const_buffer buffer = *it;
+                std::string_view piece(static_cast<const char *>(buffer.data()), buffer.size());
+                for (char c : piece)
+                {
+                    m_body.hash = (m_body.hash ^ static_cast<unsigned char>(c)) * FNV_PRIME;
+                }
+                if (!m_streaming)
+                {
+                    m_body.text.append(piece);
+                }
+                else if (!m_body.sink(piece))
+                {
+                    ec = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+                    return bytes;
+                }
+                bytes += buffer.size();
+            }
+            ec = {};
+            return bytes;
+        }
+
+        void finish(boost::beast::error_code &ec) { ec = {}; }
+
+    private:
+        value_type &m_body;
+        bool m_streaming = false;
+    };
+};
+
+// Outcome of one upstream request
+struct UpstreamResult
+{
+    bool ok = false;          // 200 with a complete body
+    bool notModified = false; // 304 to a conditional request: the previous body still stands
+    std::string body;         // Empty when the body went to a sink
+    std::uint64_t bodyHash = 0;
+    std::string etag; // Validators of a 200, for the next conditional request
+    std::string lastModified;
+    bool unchanged = false; // Set by FetchScheduler: a 304, or the same body as the job's previous kept 200
+};
+
+/**
+ * @brief One asynchronous HTTP(S) GET.
+ *
+ * Runs resolve, connect, handshake, write and read under a single deadline.
+ * The handler is called exactly once: with ok set and the response body on
+ * a 200, with notModified set on a 304, or with both clear on any other
+ * status, failure, timeout or cancel(). When a body sink is set, a 200 body
+ * goes to the sink as it arrives and the result's body is left empty.
+ *
+ * Connections come from the pool and go back to it after a keep-alive
+ * response. If a reused connection turns out to have been closed by the
+ * server, the request is sent once more on a new connection.
+ */
+class UpstreamRequest : public std::enable_shared_from_this<UpstreamRequest>
+{
+public:
+    using Handler = std::function<void(UpstreamResult result)>;
+
+    UpstreamRequest(UpstreamConnectionPool &pool, std::string target);
+
+    // Set before start()
+    void setBodySink(UpstreamBody::Sink sink) { m_sink = std::move(sink); }
+    // Makes the request conditional on the validators of an earlier response; empty ones are not sent
+    void setValidators(const std::string &etag, const std::string &lastModified);
+    void start(Handler onDone);
+    void cancel();
+
+private:
+    void connect();
+    void onResolved(const boost::system::error_code &ec, boost::asio::ip::tcp::resolver::results_type results);
+    void onConnected(const boost::system::error_code &ec);
+    void onHandshake(const boost::system::error_code &ec);
+    void sendRequest();
+    void onWritten(const boost::system::error_code &ec);
+    void onRead(const boost::system::error_code &ec);
+    bool retryOnNewConnection(const boost::system::error_code &ec);
+    void fail(const char *operation, const boost::system::error_code &ec);
+    void finish(UpstreamResult result);
+
+    UpstreamConnectionPool &m_pool;
+    const FetchOptions &m_options;
+    boost::asio::ip::tcp::resolver m_resolver;
+    std::unique_ptr<UpstreamConnectionPool::Stream> m_stream; // Only the TCP layer is used when TLS is off
+    bool m_reused = false;
+    boost::asio::steady_timer m_deadline;
+    std::chrono::steady_clock::time_point m_started;
+    boost::beast::flat_buffer m_buffer;
+    boost::beast::http::request<boost::beast::http::empty_body> m_request;
+    boost::beast::http::response<UpstreamBody> m_response;
+    UpstreamBody::Sink m_sink;
+    bool m_sinkUsed = false; // Part of the body already went to the sink, so the request cannot be retried
+    Handler m_onDone;
+    bool m_timedOut = false;
+};
+
+/**
+ * @brief Keeps a set of upstream requests refreshed on their own intervals.
+ *
+ * Each job is fetched when it falls due, with at most maxConcurrent requests
+ * in flight; jobs that fall due while the limit is reached wait in FIFO order.
+ * A job's next fetch is due one interval after its previous one started, so
+ * slow responses do not push the schedule back.
+ *
+ * Results that repeat the job's previous one, a 304 or a body with the same
+ * hash, are counted and flagged as unchanged so the handler can skip them.
+ * The handler returns whether it took the result as the job's current data;
+ * when it did not (a failure, an API message, no bars) the job's body hash
+ * and validators are dropped, so the next good response is never mistaken
+ * for a repeat of data that was not applied.
+ *
+ * Everything runs on the given io_context, which must be run by a single
+ * thread; results are delivered on it too. The scheduler must outlive that
+ * thread's run().
+ */
+class FetchScheduler
+{
+public:
+    // Returns true if the result now stands for the job's data
+    using ResultHandler = std::function<bool(const std::string &name, UpstreamResult result)>;
+    // Called as each job's request starts; its sink receives that response's body
+    using SinkFactory = std::function<UpstreamBody::Sink(const std::string &name)>;
+
+    FetchScheduler(boost::asio::io_context &ioc, std::string host, FetchOptions options, ResultHandler onResult);
+
+    FetchScheduler(const FetchScheduler &) = delete;
+    FetchScheduler &operator=(const FetchScheduler &) = delete;
+
+    // Jobs must be added before start(). The first fetch of every job is due immediately.
+    void addJob(std::string name, std::string target, std::chrono::seconds interval);
+    void start();
+
+    // Stream response bodies to per-job sinks instead of collecting them. Set before start().
+    void setBodySinks(SinkFactory makeSink) { m_makeSink = std::move(makeSink); }
+
+    // Cancels pending timers and in-flight requests; run() returns once they unwind.
+    // Safe to call from any thread.
+    void stop();
+
+    // Read on the io_context's thread, or after run() has returned
+    const UpstreamStats &stats() const { return m_pool.stats(); }
+
+private:
+    struct Job
+    {
+        Job(boost::asio::io_context &ioc, std::string name, std::string target, std::chrono::seconds interval)
+            : name(std::move(name)), target(std::move(target)), interval(interval), timer(ioc)
+        {
+        }
+
+        std::string name;
+        std::string target;
+        std::chrono::seconds interval;
+        boost::asio::steady_timer timer;
+        std::chrono::steady_clock::time_point lastStart;
+        std::shared_ptr<UpstreamRequest> request; // Set while in flight
+
+        // From the last 200 the handler kept
+        std::uint64_t bodyHash = 0;
+        bool haveBody = false;
+        std::string etag;
+        std::string lastModified;
+    };
+
+    void waitForDue(Job &job);
+    void launchReady();
+    void onFetched(Job &job, UpstreamResult result);
+
+    boost::asio::io_context &m_ioc;
+    UpstreamConnectionPool m_pool;
+    ResultHandler m_onResult;
+    SinkFactory m_makeSink;
+
+    std::vector<std::unique_ptr<Job>> m_jobs;
+    std::deque<Job *> m_ready; // Due, waiting for a free slot
+    std::size_t m_inFlight = 0;
+    bool m_stopped = false;
+};
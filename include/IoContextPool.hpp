@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A fixed set of io_contexts, each run by exactly one thread.
+ *
+ * Objects bound to one context (sockets, timers) have all their handlers run
+ * on that context's thread, so per-connection state needs no strand. New
+ * work is spread over the contexts round-robin with next().
+ */
+class IoContextPool
+{
+public:
+    // threadCount 0 means one thread per hardware core
+    explicit IoContextPool(std::size_t threadCount = 0);
+    ~IoContextPool();
+
+    IoContextPool(const IoContextPool &) = delete;
+    IoContextPool &operator=(const IoContextPool &) = delete;
+
+    // Starts one thread per context. The contexts keep running until stop().
+    void run();
+    void stop();
+    void join();
+
+    boost::asio::io_context &next();
+    std::size_t size() const { return m_contexts.size(); }
+
+private:
+    using WorkGuard = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+
+    std::vector<std::unique_ptr<boost::asio::io_context>> m_contexts;
+    std::vector<WorkGuard> m_workGuards;
+    std::vector<std::thread> m_threads;
+    std::atomic<std::size_t> m_next{0};
+};
@@ -0,0 +1,108 @@
+#pragma once
+#include "DataParser.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Incremental parser for Alpha Vantage time series JSON.
+ *
+ * Takes the document in pieces of any size, as they come off the socket,
+ * and appends a MarketDataEntry for every complete bar without building a
+ * DOM. Tokens are read in place from each piece; only a token split across
+ * two pieces is copied, into a small carry buffer.
+ *
+ * Understands the two layouts the DOM parser did:
+ *   { "Meta Data": {...}, "Time Series (1min)": { "<timestamp>": { "1. open": "..", ... } } }
+ *   [ { "timestamp": "..", "open": .., "high": .., "low": .., "close": .., "volume": .. } ]
+ * Field values may be numbers or numeric strings. A bar missing a field or
+ * holding an unparsable one is skipped and counted. Everything else in the
+ * document is checked for structure only.
+ */
+class JsonBarParser
+{
+public:
+    // Bars are appended to out, in document order
+    explicit JsonBarParser(std::vector<MarketDataEntry> &out);
+
+    // Consumes the next piece. Returns false once the document is known to be malformed.
+    bool feed(std::string_view chunk);
+
+    // Call after the last piece. True if exactly one complete document was seen.
+    bool finish();
+
+    // "Information", "Note" or "Error Message" text when the API answered with one instead of data
+    const std::string &apiMessage() const { return m_apiMessage; }
+    std::size_t skippedBars() const { return m_skippedBars; }
+
+    // Orders bars oldest first; the API sends them newest first
+    static void sortByTimestamp(std::vector<MarketDataEntry> &bars);
+
+private:
+    enum class Role : std::uint8_t
+    {
+        Skip,       // Structure only
+        RootObject, // Top-level object: looks for the series and API messages
+        RootArray,  // Top-level array of bar objects
+        Series,     // "Time Series (...)": keys are timestamps, values bars
+        Bar,        // One bar's fields
+        Message     // Top-level string value to keep as apiMessage
+    };
+
+    enum class State : std::uint8_t
+    {
+        Value,      // Expecting a value
+        FirstValue, // After '[': a value or ']'
+        FirstKey,   // After '{': a key or '}'
+        Key,        // After ',' in an object: a key
+        Colon,      // After a key
+        AfterValue, // Expecting ',' or the container's close
+        String,     // Inside a string
+        Bare,       // Inside a number or literal
+        Done,
+        Error
+    };
+
+    struct Frame
+    {
+        Role role;
+        bool isObject;
+    };
+
+    static constexpr std::size_t MAX_DEPTH = 64;
+    static constexpr std::uint8_t ALL_FIELDS = 0x3F; // Timestamp plus five prices/volume
+
+    bool fail();
+    bool openContainer(bool isObject);
+    bool closeContainer(bool isObject);
+    void finishBar();
+    void onKey(std::string_view key);
+    void onScalar(std::string_view text);
+    Role currentRole() const { return m_depth ? m_stack[m_depth - 1].role : Role::Skip; }
+
+    std::vector<MarketDataEntry> &m_out;
+    Frame m_stack[MAX_DEPTH];
+    std::size_t m_depth = 0;
+    State m_state = State::Value;
+    bool m_stringIsKey = false;
+    bool m_escaped = false; // Last string byte was an unescaped backslash
+
+    // Whether the current token's text is needed, and its start if it began in an earlier piece
+    bool m_capture = false;
+    std::string m_carry;
+    bool m_carrying = false;
+
+    // Set by the last key: what the value that follows is
+    Role m_valueRole = Role::Skip;
+    int m_field = -1;
+
+    MarketDataEntry m_bar{};
+    std::uint8_t m_barFields = 0;
+    Timestamp m_seriesTimestamp;
+    bool m_seriesTimestampValid = false;
+
+    std::string m_apiMessage;
+    std::size_t m_skippedBars = 0;
+};
@@ -0,0 +1,162 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Log-linear latency histogram in the style of HdrHistogram.
+ *
+ * Values are nanoseconds. Below SUB_BUCKET_COUNT every value has a bucket of
+ * its own; above, each power of two is split into SUB_BUCKET_COUNT equal
+ * buckets, so a value is reported to within 1/SUB_BUCKET_COUNT (1.6%) of
+ * what was recorded. Values past MAX_TRACKED (about 137 s) count in the last
+ * bucket; the maximum is kept exactly.
+ *
+ * A histogram has a single writer, so record() is a relaxed load and store
+ * per counter with no locked instruction. Any thread may read it while it is
+ * being written; LatencySnapshot adds histograms up for reporting.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 6;
+    static constexpr std::size_t SUB_BUCKET_COUNT = std::size_t(1) << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_MAGNITUDE = 36; // Highest power of two tracked
+    static constexpr std::uint64_t MAX_TRACKED = (std::uint64_t(1) << (MAX_MAGNITUDE + 1)) - 1;
+    static constexpr std::size_t BUCKET_COUNT = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT;
+
+    // Only ever called by the histogram's owning thread
+    void record(std::uint64_t nanos)
+    {
+        bump(m_counts[bucketFor(nanos)], 1);
+        bump(m_count, 1);
+        bump(m_sum, nanos);
+        if (nanos > m_max.load(std::memory_order_relaxed))
+        {
+            m_max.store(nanos, std::memory_order_relaxed);
+        }
+    }
+
+    static std::size_t bucketFor(std::uint64_t nanos);
+    // Largest value that lands in the bucket
+    static std::uint64_t highestEquivalent(std::size_t bucket);
+
+private:
+    friend class LatencySnapshot;
+
+    static void bump(std::atomic<std::uint64_t> &counter, std::uint64_t amount)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<std::uint64_t>, BUCKET_COUNT> m_counts{};
+    std::atomic<std::uint64_t> m_count{0};
+    std::atomic<std::uint64_t> m_sum{0};
+    std::atomic<std::uint64_t> m_max{0};
+};
+
+// Plain copy of one or more histograms, for reading percentiles
+class LatencySnapshot
+{
+public:
+    LatencySnapshot();
+
+    // Adds the histogram's current counts
+    void add(const LatencyHistogram &histogram);
+    // Leaves what was recorded after `earlier` was taken from the same histograms.
+    // The maximum then comes from the buckets, to within their precision.
+    void subtract(const LatencySnapshot &earlier);
+
+    std::uint64_t count() const { return m_count; }
+    std::uint64_t max() const { return m_max; }
+    double mean() const;
+    // Value at or below which `percent` of the samples fall; 0 when empty
+    std::uint64_t percentile(double percent) const;
+
+    // "n=..., p50=... us, p99=..., p99.9=..., max=..."
+    std::string summary() const;
+
+private:
+    std::vector<std::uint64_t> m_counts;
+    std::uint64_t m_count = 0;
+    std::uint64_t m_sum = 0;
+    std::uint64_t m_max = 0;
+};
+
+// Boundaries on the way from an upstream response to bytes on a client socket
+enum class LatencyStage
+{
+    Fetch,         // Upstream request sent to response complete
+    Parse,         // Response bars parsed, across every chunk, and sorted
+    CacheUpdate,   // Bars merged into the cache and the new series published
+    Serialize,     // One frame encoded, once per wire format per update
+    Enqueue,       // Frame handed to one session's send queue
+    WriteComplete, // Frame queued to its write completing on the socket
+    TickToWrite    // Upstream response, or replayed bar, to its frame written to a client
+};
+
+constexpr std::size_t LATENCY_STAGE_COUNT = 7;
+
+const char *latencyStageName(LatencyStage stage);
+
+/**
+ * @brief Process-wide latency histograms, one set per recording thread.
+ *
+ * Each thread records into a set of histograms of its own, created the first
+ * time it records, so the hot path never contends or takes a lock. Readers
+ * add the sets up. Sets are kept after their thread exits so no samples are
+ * lost from the totals.
+ */
+class LatencyRecorder
+{
+public:
+    using Snapshots = std::array<LatencySnapshot, LATENCY_STAGE_COUNT>;
+
+    static LatencyRecorder &getInstance();
+
+    // Steady-clock nanoseconds; the time base of every stage
+    static std::int64_t now();
+
+    void record(LatencyStage stage, std::int64_t nanos)
+    {
+        localShard().stages[static_cast<std::size_t>(stage)].record(nanos > 0 ? static_cast<std::uint64_t>(nanos) : 0);
+    }
+
+    // Records the time since `start`, a value of now()
+    void recordSince(LatencyStage stage, std::int64_t start) { record(stage, now() - start); }
+
+    // Every thread's samples, per stage, since the process started
+    Snapshots snapshot() const;
+
+private:
+    struct Shard
+    {
+        std::array<LatencyHistogram, LATENCY_STAGE_COUNT> stages;
+    };
+
+    LatencyRecorder() = default;
+    Shard &localShard();
+
+    mutable std::mutex m_shardsMutex; // Guards the list only; shards are read without it
+    std::vector<std::unique_ptr<Shard>> m_shards;
+};
+
+// Records the time from construction to destruction
+class ScopedLatency
+{
+public:
+    explicit ScopedLatency(LatencyStage stage) : m_stage(stage), m_start(LatencyRecorder::now()) {}
+    ~ScopedLatency() { LatencyRecorder::getInstance().recordSince(m_stage, m_start); }
+
+    ScopedLatency(const ScopedLatency &) = delete;
+    ScopedLatency &operator=(const ScopedLatency &) = delete;
+
+private:
+    LatencyStage m_stage;
+    std::int64_t m_start;
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief "{}" message formatting for the logger.
+ *
+ * Each "{}" in a format string is replaced by the next argument, and "{{" and
+ * "}}" stand for literal braces. Strings, characters, bools and numbers are
+ * appended directly; any other type needs an operator<<. Surplus arguments
+ * are ignored and a "{}" without an argument is kept as is.
+ *
+ * defer() captures a format and its arguments so a message can be formatted
+ * later, on the logger's writer thread instead of the caller's.
+ */
+namespace LogFormat
+{
+    template <typename T>
+    void appendArgument(std::string &out, const T &value)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            out += value ? "true" : "false";
+        }
+        else if constexpr (std::is_same_v<T, char>)
+        {
+            out += value;
+        }
+        else if constexpr (std::is_arithmetic_v<T>)
+        {
+            char buffer[64];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, result.ptr);
+        }
+        else if constexpr (std::is_convertible_v<const T &, std::string_view>)
+        {
+            out += std::string_view(value);
+        }
+        else
+        {
+            std::ostringstream stream;
+            stream << value;
+            out += stream.str();
+        }
+    }
+
+    // Appends format up to its first "{}", unescaping "{{" and "}}". Returns the
+    // offset just past that "{}", or npos if there is none.
+    inline std::size_t appendUntilPlaceholder(std::string &out, std::string_view format)
+    {
+        std::size_t start = 0;
+        for (;;)
+        {
+            const std::size_t brace = format.find_first_of("{}", start);
+            if (brace == std::string_view::npos || brace + 1 == format.size())
+            {
+                out.append(format.substr(start));
+                return std::string_view::npos;
+            }
+            out.append(format.substr(start, brace - start));
+            if (format[brace] == '{' && format[brace + 1] == '}')
+            {
+                return brace + 2;
+            }
+            out += format[brace];
+            // A doubled brace is one literal brace; a lone one is kept as it is
+            start = format[brace + 1] == format[brace] ? brace + 2 : brace + 1;
+        }
+    }
+
+    inline void formatTo(std::string &out, std::string_view format)
+    {
+        for (std::size_t next; (next = appendUntilPlaceholder(out, format)) != std::string_view::npos;)
+        {
+            out += "{}";
+            format.remove_prefix(next);
+        }
+    }
+
+    template <typename First, typename... Rest>
+    void formatTo(std::string &out, std::string_view format, const First &first, const Rest &...rest)
+    {
+        const std::size_t next = appendUntilPlaceholder(out, format);
+        if (next == std::string_view::npos)
+        {
+            return;
+        }
+        appendArgument(out, first);
+        formatTo(out, format.substr(next), rest...);
+    }
+
+    template <typename... Args>
+    std::string format(std::string_view format, const Args &...args)
+    {
+        std::string out;
+        formatTo(out, format, args...);
+        return out;
+    }
+
+    // A message whose formatting has been put off
+    class Message
+    {
+    public:
+        virtual ~Message() = default;
+        virtual void formatTo(std::string &out) const = 0;
+    };
+
+    template <typename... Args>
+    class DeferredMessage final : public Message
+    {
+    public:
+        template <typename... Values>
+        explicit DeferredMessage(const char *format, Values &&...values)
+            : m_format(format), m_args(std::forward<Values>(values)...)
+        {
+        }
+
+        void formatTo(std::string &out) const override
+        {
+            std::apply([this, &out](const Args &...args)
+                       { LogFormat::formatTo(out, m_format, args...); },
+                       m_args);
+        }
+
+    private:
+        const char *m_format;
+        std::tuple<Args...> m_args;
+    };
+
+    // How an argument is kept until it is formatted. Strings are copied, since the
+    // caller's may be gone by then; everything else is kept by value.
+    template <typename T>
+    using Stored = std::conditional_t<std::is_convertible_v<const std::decay_t<T> &, std::string_view>,
+                                      std::string, std::decay_t<T>>;
+
+    // format must outlive the message; the logger only passes string literals
+    template <typename... Args>
+    std::unique_ptr<Message> defer(const char *format, Args &&...args)
+    {
+        return std::make_unique<DeferredMessage<Stored<Args>...>>(format, Stored<Args>(std::forward<Args>(args))...);
+    }
+}
@@ -1,11 +1,54 @@
 #pragma once
 
+#include "LogFormat.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <memory>
 #include <mutex>
+#include <thread>
 
+// Lowest level compiled in: 0 = INFO, 1 = WARNING, 2 = ERROR. Set by the
+// FLASHFEED_LOG_MIN_LEVEL CMake option; calls below it compile to nothing.
+#ifndef FLASHFEED_LOG_MIN_LEVEL
+#define FLASHFEED_LOG_MIN_LEVEL 0
+#endif
 
+// Logs a "{}"-formatted message, e.g. FLASHFEED_LOG_INFO("Fetched {} bars for {}", count, symbol).
+// The arguments are only evaluated when the level is enabled, and are formatted
+// on the writer thread. The format must be a string literal.
+#define FLASHFEED_LOG(level, ...)                                \
+    do                                                           \
+    {                                                            \
+        if constexpr (Logger::compiledIn(level))                 \
+        {                                                        \
+            Logger &flashfeedLogger_ = Logger::getInstance();    \
+            if (flashfeedLogger_.enabled(level))                 \
+            {                                                    \
+                flashfeedLogger_.logf(level, __VA_ARGS__);       \
+            }                                                    \
+        }                                                        \
+    } while (false)
+
+#define FLASHFEED_LOG_INFO(...) FLASHFEED_LOG(Logger::LogLevel::INFO, __VA_ARGS__)
+#define FLASHFEED_LOG_WARNING(...) FLASHFEED_LOG(Logger::LogLevel::WARNING, __VA_ARGS__)
+#define FLASHFEED_LOG_ERROR(...) FLASHFEED_LOG(Logger::LogLevel::ERROR, __VA_ARGS__)
+
+/**
+ * @brief Process-wide asynchronous log.
+ *
+ * log() stamps the message with the time and hands it to a background writer
+ * through a bounded lock-free ring; it never takes a mutex or touches the file.
+ * The writer drains whatever has queued, formats it and writes it as one batch,
+ * flushing once per batch rather than once per line.
+ *
+ * When the ring is full, INFO and WARNING messages are dropped and counted,
+ * and the writer reports the count in the log. ERROR messages wait for room.
+ */
 class Logger
 {
 public:
@@ -16,6 +59,17 @@ enum class LogLevel
     ERROR
 };
 
+    struct Stats
+    {
+        std::uint64_t logged = 0;  // Accepted into the ring
+        std::uint64_t written = 0; // Handed to the file or stderr
+        std::uint64_t dropped = 0; // Discarded because the ring was full
+        std::uint64_t stalls = 0;  // ERROR messages that had to wait for room
+    };
+
+    // Messages queued before log() starts dropping
+    static constexpr std::size_t CAPACITY = 8192;
+
     Logger(const Logger&)=delete;
     Logger& operator=(const Logger&) = delete;
 
@@ -25,16 +79,87 @@ enum class LogLevel
         return instance;
     }
 
+    static constexpr bool compiledIn(LogLevel level)
+    {
+        return static_cast<int>(level) >= FLASHFEED_LOG_MIN_LEVEL;
+    }
+
+    bool enabled(LogLevel level) const
+    {
+        return compiledIn(level) && level >= m_level.load(std::memory_order_relaxed);
+    }
 
-    void log(const std::string& message, LogLevel level);
+    // Queues the message and returns without waiting for it to be written
+    void log(std::string message, LogLevel level)
+    {
+        if (enabled(level))
+        {
+            enqueue(std::move(message), level);
+        }
+    }
+
+    // Queues a format and copies of its arguments; the writer thread formats them.
+    // Prefer the FLASHFEED_LOG_* macros, which also skip evaluating the arguments.
+    template <std::size_t N, typename... Args>
+    void logf(LogLevel level, const char (&format)[N], Args &&...args)
+    {
+        if (enabled(level))
+        {
+            enqueue(LogFormat::defer(format, std::forward<Args>(args)...), level);
+        }
+    }
+
+    // Messages below level are discarded at run time
+    void setLevel(LogLevel level) { m_level.store(level, std::memory_order_relaxed); }
+    LogLevel level() const { return m_level.load(std::memory_order_relaxed); }
+
+    // Writes everything queued so far, then switches to the file
     void setLogFile(const std::string& logFile);
 
+    // Blocks until every message logged before the call has been written
+    void flush();
+
+    Stats stats() const;
+
 private:
-    std::ofstream m_logStream;
-    std::mutex logMutex;
+    struct alignas(64) Record
+    {
+        std::atomic<std::uint64_t> sequence{0}; // Position it can be written at, or that position + 1 once filled
+        LogLevel level = LogLevel::INFO;
+        std::int64_t timeNs = 0; // system_clock since the epoch
+        std::string message;
+        std::unique_ptr<LogFormat::Message> deferred; // Formatted in place of message when set
+    };
 
-    Logger(/* args */)=default;
+    Logger();
     ~Logger();
 
-};
+    void enqueue(std::string &&message, LogLevel level);
+    void enqueue(std::unique_ptr<LogFormat::Message> message, LogLevel level);
+    // Claims the next free slot; nullptr if the message is to be dropped
+    Record *claim(LogLevel level, std::uint64_t &position);
+    void publish(Record &record, std::uint64_t position, LogLevel level);
+    void writerLoop();
+    // Formats the records ready at the head of the ring and frees their slots; returns how many
+    std::size_t drain(std::string &batch);
+    void wakeWriter();
+
+    std::unique_ptr<Record[]> m_ring;
+    alignas(64) std::atomic<std::uint64_t> m_tail{0};     // Next position a producer claims
+    alignas(64) std::atomic<std::uint64_t> m_consumed{0}; // Positions written out; flush() waits on it
+    std::uint64_t m_head = 0;                             // Next position to drain; writer thread only
+    std::atomic<LogLevel> m_level{LogLevel::INFO};
+
+    std::atomic<std::uint64_t> m_dropped{0};
+    std::atomic<std::uint64_t> m_stalls{0};
 
+    std::atomic<bool> m_writerSleeping{false};
+    std::atomic<bool> m_stopping{false};
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_flushed;
+
+    std::ofstream m_logStream;
+    std::mutex m_outputMutex; // Held by the writer while writing and by setLogFile
+    std::thread m_writer;
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Read-only view of a whole file.
+ *
+ * Uses mmap on POSIX systems so parsers can scan the bytes in place without
+ * copying them into a stream first. Other platforms read the file into an
+ * owned buffer once.
+ *
+ * A mapping is only safe while nobody truncates or rewrites the file in
+ * place: reading a page past the new end raises SIGBUS. Files that may be
+ * edited while they are open (replaced by rename is fine) should be opened
+ * with Mode::Copy.
+ */
+class MappedFile
+{
+public:
+    enum class Mode
+    {
+        Map, // mmap where available
+        Copy // Read into an owned buffer; later changes to the file cannot affect it
+    };
+
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path, Mode mode = Mode::Map);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    // Maps or reads the file at path, releasing any previous contents. Returns false if the file cannot be opened or read.
+    bool open(const std::string &path, Mode mode = Mode::Map);
+    void close();
+
+    bool isOpen() const { return m_isOpen; }
+    const char *data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    std::string_view view() const { return std::string_view(m_data, m_size); }
+
+private:
+    const char *m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_isOpen = false;
+    bool m_isMapped = false;
+    std::string m_buffer; // Owned copy with Mode::Copy or when mmap is unavailable
+};
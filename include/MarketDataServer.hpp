@@ -1,18 +1,28 @@
 #pragma once
 #include <memory>
+#include <utility> // Before Asio: Boost 1.74's awaitable.hpp uses std::exchange without including it
 #include <boost/asio.hpp>
 #include "DataParser.hpp"
-#include <utility>
+#include "TimeSeriesStore.hpp"
+#include "WireProtocol.hpp"
+#include "SymbolTable.hpp"
+#include "FetchScheduler.hpp"
+#include "ReplayEngine.hpp"
 #include <unordered_map>
 #include <string>
 #include <boost/beast.hpp>
 #include <boost/beast/ssl.hpp>
 #include <boost/asio/ssl.hpp>
 #include <nlohmann/json.hpp>
+#include <array>
+#include <map>
 #include <set>        
 #include <mutex>      
 #include <thread>    
 #include <chrono>
+#include <atomic>
+#include <deque>
+#include <functional>
 
 namespace net = boost::asio;
 using tcp = net::ip::tcp;
@@ -25,66 +35,330 @@ namespace MarketDataServer
   constexpr int DEFAULT_PORT = 8080;
   // constexpr auto API_REFRESH_INTERVAL = std::chrono::seconds(60); // Fetch data every 1 second
 
+  // What a connection does when its send queue is full
+  enum class SlowConsumerPolicy
+  {
+    DropOldest, // Discard the oldest queued frame; delta clients resync on the sequence gap
+    Conflate,   // Replace the newest queued frame for the same symbol, else drop the oldest
+    Disconnect  // Close the connection
+  };
+
+  // Parses "drop_oldest", "conflate" or "disconnect". Returns false for anything else.
+  bool parseSlowConsumerPolicy(const std::string &name, SlowConsumerPolicy &out);
+  const char *slowConsumerPolicyName(SlowConsumerPolicy policy);
+
+  struct SendQueueOptions
+  {
+    std::size_t maxDepth = 256; // Frames queued per connection, including the batch being written
+    SlowConsumerPolicy policy = SlowConsumerPolicy::DropOldest;
+  };
+
+  // Deadlines for a session's socket operations; 0 disables one
+  struct SessionTimeouts
+  {
+    std::chrono::seconds idle{0};   // Waiting for the next command. Subscribers normally go quiet, so off by default
+    std::chrono::seconds write{30}; // One batched write; a client that stops reading entirely is closed
+  };
+
   struct ServerConfig
   {
     int port = DEFAULT_PORT;
     std::string apiKey;
     std::vector<std::string> symbols;
     std::unordered_map<std::string, std::string> symbolCSVPaths;
+    std::string snapshotDirectory; // Per-symbol series snapshots for a warm start; empty disables them
 
     int apiRefreshSeconds = 60; // Default refresh interval in seconds
+    std::unordered_map<std::string, int> symbolRefreshSeconds; // Per-symbol overrides of apiRefreshSeconds
     std::string apiHost = "www.alphavantage.co"; // Default API host
     std::string apiBasePath = "/query";          // Default API base path
     std::string apiFunction = "TIME_SERIES_INTRADAY"; // Default function
     std::string apiInterval = "1min";                // Default interval
+    FetchOptions fetch;                              // Port, TLS, concurrency limit and timeout of upstream requests
+
+    SendQueueOptions sendQueue; // Per-client outgoing queue bound and slow-consumer policy
+    unsigned ioThreads = 0;     // Threads serving client sessions; 0 means one per core
+    SessionTimeouts timeouts;
 
+    ReplayOptions replay; // Publish the CSV files' bars in timestamp order instead of fetching
+
+    std::chrono::seconds latencyReportInterval{60}; // Per-stage latency percentiles are logged this often; 0 disables
+    bool statsCommandEnabled = false; // Answer STATS; any connected client could read the server's latency figures
+
+    std::size_t maxBarsPerSymbol = 50000; // Newest bars kept per symbol, about a month of 1-minute bars; 0 keeps all
   };
 
+  /**
+   * @brief Per-symbol market data, published as immutable snapshots.
+   *
+   * Writers build a new series off to the side and swap it in atomically;
+   * readers take a shared_ptr to whatever version is current without copying
+   * it and without waiting for a merge to finish. A snapshot stays valid for
+   * as long as the reader holds it, even after newer versions are published.
+   *
+   * The swap goes through std::atomic_load/atomic_store on shared_ptr, which
+   * libstdc++ implements with a small pool of spinlocks keyed by address. A
+   * load or store holds one only for the pointer copy and reference count
+   * update, never for the merge, so readers and writers contend for a few
+   * instructions at most, but the load is not lock-free.
+   *
+   * Updates are merged bar by bar rather than replacing the history, and each
+   * symbol's sequence number only advances when a bar actually changes. Data
+   * that must not mix with what is cached, such as CSV fallback bars after API
+   * bars, replaces the series instead. A series keeps at most maxBars() bars.
+   *
+   * Series are kept in a flat array indexed by SymbolId, so a lookup is one
+   * shared_ptr load with no string hashing. Name-based lookups go through the
+   * SymbolTable first.
+   */
   class DataCache
   {
   public:
-    void updateData(const std::string &symbol, const std::vector<MarketDataEntry> &data);
+    using SeriesPtr = std::shared_ptr<const ColumnarSeries>;
+
+    enum class UpdateMode
+    {
+      Merge,  // Add new bars and changed values to the history
+      Replace // Make data the whole history
+    };
+
+    explicit DataCache(const SymbolTable &symbols);
+
+    // Merges data into the symbol's series, or replaces it, and publishes a new version
+    // only if something changed. The returned update carries the new sequence number.
+    // Bars all newer than the series' last one are appended without copying the history.
+    SeriesUpdate updateData(SymbolId symbol, const std::vector<MarketDataEntry> &data, UpdateMode mode = UpdateMode::Merge);
+
+    // Bars kept per symbol, the oldest dropped first; 0 keeps them all. Applies from the next update.
+    void setMaxBars(std::size_t maxBars);
+    std::size_t maxBars() const;
+
+    // Current snapshot of the symbol's series, or nullptr if it has none
+    SeriesPtr getSeries(SymbolId symbol) const;
+    SeriesPtr getSeries(const std::string &symbol) const;
+
+    // Compatibility shim: copies the cached series out as rows
     std::vector<MarketDataEntry> getData(const std::string &symbol) const;
 
+    // Writes the symbol's current series to a SeriesSnapshot file. False, with error set,
+    // if there is no series or the write fails.
+    bool saveSnapshot(SymbolId symbol, const std::string &name, const std::string &path, std::string &error) const;
+    // Installs the series from a snapshot file written for the same symbol name, keeping
+    // its sequence numbers. Only fills an empty slot, so fresher data is never replaced.
+    bool restoreSnapshot(SymbolId symbol, const std::string &name, const std::string &path, std::string &error);
+
+  private:
+    const SymbolTable &m_symbols;
+
+    // One slot per possible id; each slot only touched through std::atomic_load/atomic_store
+    std::unique_ptr<SeriesPtr[]> m_series;
+    mutable std::mutex m_writeMutex; // Serializes writers only
+    std::size_t m_maxBars = 0;       // Guarded by m_writeMutex
+  };
+
+  // Counters for one connection's send queue
+  struct SendQueueStats
+  {
+    std::size_t depth = 0;         // Frames queued now, including the batch being written
+    std::size_t maxDepthSeen = 0;  // High-water mark
+    std::uint64_t framesSent = 0;
+    std::uint64_t bytesSent = 0;
+    std::uint64_t framesDropped = 0;
+    std::uint64_t framesConflated = 0;
+  };
+
+  // One client connection. Reads newline-terminated commands asynchronously and
+  // writes frames through a bounded send queue. Every socket operation runs on
+  // the io_context the session was accepted on; other threads only queue frames.
+  // With FLASHFEED_USE_COROUTINES the read and write loops are Asio coroutines,
+  // otherwise chained completion handlers; both share the helpers below.
+  class Session : public std::enable_shared_from_this<Session>
+  {
+  public:
+    using CommandHandler = std::function<void(const std::shared_ptr<Session> &, const std::string &line)>;
+    using CloseHandler = std::function<void(const std::shared_ptr<Session> &)>;
+
+    // Longest command line accepted before the session is closed
+    static constexpr std::size_t MAX_COMMAND_LENGTH = 4096;
+
+    Session(tcp::socket socket, SendQueueOptions options, SessionTimeouts timeouts = {});
+
+    Session(const Session &) = delete;
+    Session &operator=(const Session &) = delete;
+
+    // Starts the read loop. onCommand runs for each line on the session's thread;
+    // onClose runs once, when the client disconnects or a read fails.
+    void start(CommandHandler onCommand, CloseHandler onClose);
+
+    // Commands received so far, including the one being handled
+    std::uint64_t commandCount() const { return m_commandCount; }
+
+    // Set by "HELLO DELTA": snapshot once, then incremental UPDATE frames
+    bool deltaMode() const { return m_deltaMode; }
+    void setDeltaMode(bool enabled) { m_deltaMode = enabled; }
+
+    // Set by "HELLO BINARY": frames use the WireProtocol binary header and packed records
+    bool binaryMode() const { return m_binaryMode; }
+    void setBinaryMode(bool enabled) { m_binaryMode = enabled; }
+
+    // Queues one frame and returns without waiting for the socket. Safe to call
+    // from any thread. Frames are written in order by async_write, batching
+    // whatever is queued into one gather write. When the queue is full the
+    // slow-consumer policy applies. Returns false if the session is closed or
+    // was closed by the policy. The frame may be shared with other sessions and
+    // is never modified.
+    bool send(const WireProtocol::SharedFrame &frame);
+
+    SendQueueStats sendQueueStats() const;
+
+    // Stops accepting frames and closes the socket once the queue has drained
+    void close();
+
+    // Closes the socket now, abandoning queued frames. Pending reads and writes
+    // complete with operation_aborted and the session ends through onClose.
+    void cancel();
+
   private:
-    std::unordered_map<std::string, std::vector<MarketDataEntry>> m_cache;
-    mutable std::mutex m_mutex;
+    struct QueuedFrame
+    {
+      WireProtocol::SharedFrame binding; // Symbol frame the client needs first, if any
+      WireProtocol::SharedFrame frame;
+      std::int64_t queuedAt; // LatencyRecorder::now() when send() queued it
+    };
+
+#ifdef FLASHFEED_USE_COROUTINES
+    net::awaitable<void> readLoop();
+    net::awaitable<void> writeLoop();
+#else
+    void doRead();
+    void handleRead(const boost::system::error_code &ec, std::size_t bytesTransferred);
+    void startWrite();
+    void handleWrite(const boost::system::error_code &ec, std::size_t bytesTransferred);
+#endif
+    void dispatchCommand();
+    void endSession(const boost::system::error_code &ec);
+    void scheduleWrite();
+
+    // Closes the socket if the timer expires before disarmTimeout is called
+    void armTimeout(net::steady_timer &timer, std::chrono::seconds timeout, const char *operation);
+    static void disarmTimeout(net::steady_timer &timer);
+
+    // The helpers below expect m_queueMutex to be held
+    bool prepareWrite();
+    bool finishWrite(const boost::system::error_code &ec, std::size_t bytesTransferred);
+    bool conflate(const WireProtocol::SharedFrame &frame);
+    bool dropOldest();
+    void closeSocket();
+
+    tcp::socket m_socket;
+    const SendQueueOptions m_options;
+    const SessionTimeouts m_timeouts;
+    net::steady_timer m_readTimer;
+    net::steady_timer m_writeTimer;
+    std::atomic<bool> m_deltaMode{false};
+    std::atomic<bool> m_binaryMode{false};
+
+    // Read side; only touched on the session's thread
+    boost::asio::streambuf m_readBuffer{MAX_COMMAND_LENGTH};
+    CommandHandler m_onCommand;
+    CloseHandler m_onClose;
+    std::uint64_t m_commandCount = 0;
+
+    mutable std::mutex m_queueMutex;
+    std::deque<QueuedFrame> m_queue;           // Front m_inFlight entries are being written
+    std::size_t m_inFlight = 0;
+    bool m_writeScheduled = false;             // A writer is posted or running on the session's thread
+    std::vector<net::const_buffer> m_writeBuffers;
+    bool m_closed = false;         // No more frames are accepted
+    bool m_closeRequested = false; // close() was called; the socket closes once the queue drains
+    SendQueueStats m_stats;
+    std::vector<bool> m_announcedSymbols; // Indexed by SymbolId; binary Symbol frames already sent
   };
 
+  using SessionPtr = std::shared_ptr<Session>;
+
+  /**
+   * @brief Which sessions are subscribed to which symbols.
+   *
+   * Each symbol's subscriber list is an immutable vector in a flat array
+   * indexed by SymbolId, published the same way DataCache publishes series:
+   * writers copy the one list they change and swap the new version in, so
+   * getSubscribers() only loads a snapshot and never waits while a writer
+   * copies a list. Writers take one of a set of striped mutexes, so different
+   * symbols rarely contend.
+   *
+   * A reverse index from session to its symbols makes disconnect cleanup touch
+   * only the symbols that session subscribed to. Entries for sessions that died
+   * without being removed are swept the first time a reader runs into them.
+   */
   class SubscriptionManager
   {
   public:
     SubscriptionManager(const SubscriptionManager &) = delete;
     SubscriptionManager &operator=(const SubscriptionManager &) = delete;
 
-    SubscriptionManager() = default;
+    SubscriptionManager();
     ~SubscriptionManager() = default;
 
-    void addSubscription(const std::string &symbol, std::shared_ptr<tcp::socket> socket_ptr);
+    // Returns false if the session was already subscribed to the symbol
+    bool addSubscription(SymbolId symbol, SessionPtr connection);
 
-    void removeSubscription(const std::string &symbol, std::shared_ptr<tcp::socket> socket_ptr);
+    // Returns false if the session was not subscribed to the symbol
+    bool removeSubscription(SymbolId symbol, SessionPtr connection);
 
-    void removeAllSubscriptions(std::shared_ptr<tcp::socket> socket_ptr);
+    // Returns how many subscriptions the session had
+    std::size_t removeAllSubscriptions(SessionPtr connection);
 
-    std::vector<std::shared_ptr<tcp::socket>> getSubscribers(const std::string &symbol);
+    // Live subscribers of the symbol. Takes no mutex unless it has expired sessions to
+    // sweep; the shared_ptr snapshot load briefly holds a standard library spinlock (see DataCache).
+    std::vector<SessionPtr> getSubscribers(SymbolId symbol);
 
   private:
-    std::unordered_map<std::string, std::set<std::weak_ptr<tcp::socket>, std::owner_less<std::weak_ptr<tcp::socket>>>> m_subscriptions;
-    std::mutex m_mutex; // Mutex to protect access to m_subscriptions
+    static constexpr std::size_t WRITE_STRIPES = 16;
+
+    using SessionRef = std::weak_ptr<Session>;
+    using SubscriberList = std::vector<SessionRef>;
+    using SubscriberListPtr = std::shared_ptr<const SubscriberList>;
+
+    // Publishes a copy of the symbol's list with edit applied. Returns false if
+    // edit reported no change.
+    template <typename Edit>
+    bool updateSubscribers(SymbolId symbol, Edit edit);
+
+    // Drops expired sessions from one symbol's list and from the reverse index
+    void sweep(SymbolId symbol);
+
+    // One slot per possible id; each slot only touched through std::atomic_load/atomic_store
+    std::unique_ptr<SubscriberListPtr[]> m_subscribers;
+    std::array<std::mutex, WRITE_STRIPES> m_writeMutexes; // A symbol's writers take m_writeMutexes[id % WRITE_STRIPES]
+
+    // Reverse index, keyed by owner so an expired entry can still be found and erased
+    std::map<SessionRef, std::vector<SymbolId>, std::owner_less<SessionRef>> m_symbolsBySession;
+    std::mutex m_sessionsMutex; // Guards m_symbolsBySession; never held with a stripe mutex
   };
 
   // Start the server with the given configuration
   void StartServer(const ServerConfig &config,SubscriptionManager& subManager);
 
-  // Fetch data from Alpha Vantage API
+  // Fetch data from Alpha Vantage API with one blocking request over a shared keep-alive pool; empty on failure
   std::string FetchMarketData(const std::string &symbol, const MarketDataServer::ServerConfig& config);
 
-  // Method for Startting periodic fetching
+  // Loads the configured symbols' snapshots into the cache, so data can be served before the first fetch
+  void RestoreSnapshots(const ServerConfig &config);
+
+  // Method for Startting periodic fetching: symbols are refreshed concurrently by a FetchScheduler
   std::thread StartPeriodicFetching(const ServerConfig &config, SubscriptionManager& subManager);
 
   // Method to stop periodic fetching
   void StopPeriodicFetching();
 
+  // Replays every configured symbol's CSV bars to subscribers, merged in timestamp order at
+  // config.replay.speed, on a thread of its own. Used instead of StartPeriodicFetching.
+  std::thread StartReplay(const ServerConfig &config, SubscriptionManager &subManager);
+
+  // Ends a running replay early
+  void StopReplay();
+
   // Get the latest data for a symbol
   std::vector<MarketDataEntry> GetLatestData(const std::string &symbol);
 
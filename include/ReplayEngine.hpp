@@ -0,0 +1,93 @@
+#pragma once
+#include "DataParser.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// How historical bars are replayed
+struct ReplayOptions
+{
+    bool enabled = false;               // Replay the CSV files instead of fetching from the API
+    double speed = 1.0;                 // Multiple of real time; 0 publishes as fast as possible
+    std::chrono::seconds startDelay{5}; // Time for clients to connect and subscribe before the first bar
+    std::chrono::seconds reportInterval{5};
+};
+
+// Progress of a replay. Lateness is how far after its scheduled time a bar went out.
+struct ReplayStats
+{
+    std::size_t bars = 0;
+    std::chrono::nanoseconds elapsed{0};
+    std::chrono::nanoseconds latenessP50{0};
+    std::chrono::nanoseconds latenessP99{0};
+    std::chrono::nanoseconds latenessMax{0};
+    bool paced = true; // False at speed 0, where lateness is meaningless
+
+    double barsPerSecond() const;
+    std::string summary() const;
+};
+
+/**
+ * @brief Publishes several symbols' historical bars in timestamp order.
+ *
+ * Streams are merged with a min-heap keyed on each stream's next bar, so bars
+ * of all symbols go out in one global timestamp order (ties in stream order).
+ * Each bar is due at replayStart + (timestamp - firstTimestamp) / speed.
+ * Bars are released a tick at a time: every bar due by the time the tick's
+ * deadline is met, so a publisher that falls behind catches up in fewer,
+ * larger batches instead of one call per bar. Each stream's share of a tick
+ * is handed to the publisher in one call; at full speed a tick is one timestamp.
+ * Deadlines are absolute, so time spent publishing does not accumulate as
+ * drift the way a sleep between bars would. The wait sleeps until shortly
+ * before a deadline and yields for the rest, trading a little CPU for a
+ * precise release time.
+ *
+ * run() blocks the calling thread; stop() may be called from any other.
+ */
+class ReplayEngine
+{
+public:
+    // Receives one stream's bars for a tick, in timestamp order
+    using Publisher = std::function<void(std::size_t stream, const std::vector<MarketDataEntry> &bars)>;
+
+    ReplayEngine(ReplayOptions options, Publisher publish);
+
+    ReplayEngine(const ReplayEngine &) = delete;
+    ReplayEngine &operator=(const ReplayEngine &) = delete;
+
+    // Bars must be in timestamp order. Returns the stream's index as passed to the publisher.
+    std::size_t addStream(std::vector<MarketDataEntry> bars);
+
+    // Publishes every bar, then returns; returns early once stop() is called
+    void run();
+    void stop();
+
+    // Final figures once run() has returned
+    ReplayStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // False if stopped before the deadline
+    bool waitUntil(Clock::time_point deadline);
+    ReplayStats computeStats(Clock::time_point now) const;
+
+    ReplayOptions m_options;
+    Publisher m_publish;
+    std::vector<std::vector<MarketDataEntry>> m_streams;
+
+    std::atomic<bool> m_stopped{false};
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+
+    Clock::time_point m_started;
+    std::size_t m_published = 0;
+    std::vector<std::int64_t> m_latenessNs; // One sample per tick
+    Clock::time_point m_finished;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include "TimeSeriesStore.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief On-disk copy of one symbol's ColumnarSeries.
+ *
+ * A snapshot file holds a fixed HEADER_SIZE header, the symbol name and then
+ * the series' seven columns, each starting on a 64-byte boundary so a
+ * mapping of the file can be scanned column by column like the series
+ * itself. All integers and doubles are stored in the host's byte order,
+ * which the header records; a file from a host of the other order is
+ * rejected rather than swapped.
+ *
+ *   offset  0  char[8] magic "FFSERIES"
+ *           8  u32     format version (FORMAT_VERSION)
+ *          12  u32     byte order tag, BYTE_ORDER_TAG as written
+ *          16  u64     row count
+ *          24  u64     series sequence
+ *          32  u32     symbol length
+ *          36  u32     column count (COLUMN_COUNT)
+ *          40  u64     payload bytes (everything after the header)
+ *          48  u32     CRC-32 of the payload
+ *          52  u32     CRC-32 of header bytes 0..51
+ *          56  u8[8]   reserved, zero
+ *
+ *   payload: symbol name, zero padded to 64 bytes; then i64 timestamp
+ *   nanoseconds, f64 open, high, low, close, volume and u64 row sequence
+ *   columns, each zero padded to 64 bytes.
+ *
+ * Files are written to a temporary name and renamed over the old one, so a
+ * reader sees either the previous snapshot or the new one, never a torn file.
+ */
+namespace SeriesSnapshot
+{
+    constexpr std::uint32_t FORMAT_VERSION = 1;
+    constexpr std::uint32_t BYTE_ORDER_TAG = 0x01020304;
+    constexpr std::size_t HEADER_SIZE = 64;
+    constexpr std::uint32_t COLUMN_COUNT = 7;
+    constexpr const char *FILE_EXTENSION = ".ffs";
+
+    // <directory>/<symbol>.ffs
+    std::string pathFor(const std::string &directory, const std::string &symbol);
+
+    // Writes series as symbol's snapshot. Returns false and sets error on failure.
+    bool write(const std::string &path, const std::string &symbol, const ColumnarSeries &series, std::string &error);
+
+    // Reads and verifies a snapshot. Returns false and sets error if the file is
+    // missing, of another format version or byte order, truncated or corrupt.
+    bool read(const std::string &path, std::string &symbol, ColumnarSeries &series, std::string &error);
+}
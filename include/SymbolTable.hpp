@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using SymbolId = std::uint32_t;
+
+/**
+ * @brief Assigns dense numeric ids to symbol names.
+ *
+ * Ids start at 0 and are never reused, so a client that has learned an id
+ * can keep using it for the rest of the connection. Because ids are dense and
+ * bounded by MAX_SYMBOLS, per-symbol state elsewhere lives in flat arrays
+ * indexed by id instead of string-keyed maps. Thread-safe.
+ */
+class SymbolTable
+{
+public:
+    // Distinct symbols the table will assign ids to; id-indexed arrays are sized to match
+    static constexpr std::size_t MAX_SYMBOLS = 65536;
+    static constexpr SymbolId INVALID_ID = std::numeric_limits<SymbolId>::max();
+
+    // Returns the id for symbol, assigning the next free id on first use.
+    // Empty once MAX_SYMBOLS ids have been handed out.
+    std::optional<SymbolId> intern(const std::string &symbol);
+
+    std::optional<SymbolId> find(const std::string &symbol) const;
+    std::optional<std::string> name(SymbolId id) const;
+
+    std::size_t size() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, SymbolId> m_ids;
+    std::vector<std::string> m_names;
+};
@@ -0,0 +1,225 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "DataParser.hpp"
+#include "Timestamp.hpp"
+
+/**
+ * @brief Allocator returning storage aligned to a fixed boundary (a cache line by default).
+ */
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept {}
+
+    T *allocate(std::size_t n)
+    {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T *p, std::size_t) noexcept
+    {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const noexcept { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+/**
+ * @brief Read-only view over one contiguous column.
+ */
+template <typename T>
+class ColumnView
+{
+public:
+    ColumnView() = default;
+    ColumnView(const T *data, std::size_t size) : m_data(data), m_size(size) {}
+
+    const T *data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const T &operator[](std::size_t i) const { return m_data[i]; }
+    const T *begin() const { return m_data; }
+    const T *end() const { return m_data + m_size; }
+
+private:
+    const T *m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+/**
+ * @brief What a merge changed in a series, and the sequence numbers on either side of it.
+ */
+struct SeriesUpdate
+{
+    std::uint64_t previousSequence = 0;
+    std::uint64_t sequence = 0; // Equal to previousSequence when nothing changed
+    std::size_t appended = 0;   // New bars after the previous last bar
+    std::size_t inserted = 0;   // New bars that landed before it
+    std::size_t replaced = 0;   // Existing bars whose values changed
+    std::size_t removed = 0;    // Existing bars dropped: the oldest past the row limit, or all of them on a reset
+    bool reset = false;         // The series was replaced outright; the changed rows alone no longer describe it
+
+    bool changed() const { return reset || appended + inserted + replaced + removed > 0; }
+};
+
+/**
+ * @brief One symbol's bars stored column by column (structure of arrays).
+ *
+ * Each column's storage starts on a 64-byte boundary and keeps at least one
+ * whole 64-byte chunk of padding past its last row, so a scan over one field
+ * touches only that field's cache lines and SIMD loops can process full chunks
+ * without a scalar tail reading past the allocation. Dropping the oldest rows
+ * only moves the start of the view, so a trimmed series' first row need not
+ * sit on a boundary.
+ *
+ * Successive versions of a series share that storage. Rows are only ever
+ * written past the last row any version holds, so merge() can append bars
+ * newer than the last one in place, in time proportional to the new bars,
+ * while readers keep scanning the version they already have. Copies share
+ * storage too; instance mutators move to storage of their own before writing
+ * into storage another copy uses.
+ *
+ * A series carries a sequence number that increases every time it changes,
+ * and each row records the sequence at which it was last written, so
+ * consumers can ask for exactly the rows that changed since a version they hold.
+ */
+class ColumnarSeries
+{
+public:
+    static constexpr std::size_t CHUNK_BYTES = 64;
+    static constexpr std::size_t CHUNK_ELEMENTS = CHUNK_BYTES / sizeof(double);
+
+    ColumnarSeries() = default;
+    explicit ColumnarSeries(const std::vector<MarketDataEntry> &entries);
+
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    void clear();
+    void reserve(std::size_t rows);
+    // Appended and assigned rows are stamped with the series' current sequence
+    void append(const MarketDataEntry &entry);
+    void assign(const std::vector<MarketDataEntry> &entries);
+    // Replaces the contents with rows given column by column, row sequences included
+    void assignColumns(std::size_t rows, const Timestamp *timestamps, const double *open, const double *high,
+                       const double *low, const double *close, const double *volume, const std::uint64_t *rowSequences);
+
+    std::uint64_t sequence() const { return m_sequence; }
+    void setSequence(std::uint64_t sequence)
+    {
+        m_sequence = sequence;
+        m_firstChanged = 0; // Nothing is known about which rows carry the new sequence
+    }
+
+    // Merges timestamp-sorted incoming bars into base: bars with new timestamps are
+    // added, bars whose values differ replace the old ones, and bars missing from
+    // incoming are kept. Changed rows are stamped with base.sequence() + 1. With a
+    // non-zero maxRows only the newest maxRows bars are kept.
+    // `out` is only written when the returned update reports a change. When every
+    // incoming bar is newer than base's last one they are appended to base's storage
+    // in place, so merges into the same base must not run concurrently.
+    static SeriesUpdate merge(const ColumnarSeries &base, const std::vector<MarketDataEntry> &incoming, ColumnarSeries &out,
+                              std::size_t maxRows = 0);
+
+    // Makes the timestamp-sorted incoming bars the whole series, all stamped with
+    // base.sequence() + 1, for data that must not be mixed with base. A reset unless
+    // base was empty. `out` is only written when the returned update reports a change.
+    static SeriesUpdate replace(const ColumnarSeries &base, const std::vector<MarketDataEntry> &incoming, ColumnarSeries &out,
+                                std::size_t maxRows = 0);
+
+    // Rows written after `sequence`, in timestamp order. Asking for the changes since
+    // the previous version only scans from the first row that version changed.
+    std::vector<MarketDataEntry> changedSince(std::uint64_t sequence) const;
+
+    // Reassembles one row; prefer the column views for scans
+    MarketDataEntry row(std::size_t i) const;
+    // Array-of-structs copy for callers that still want MarketDataEntry rows
+    std::vector<MarketDataEntry> toEntries() const;
+
+    ColumnView<Timestamp> timestamps() const { return view(&Columns::timestamps); }
+    ColumnView<double> opens() const { return view(&Columns::open); }
+    ColumnView<double> highs() const { return view(&Columns::high); }
+    ColumnView<double> lows() const { return view(&Columns::low); }
+    ColumnView<double> closes() const { return view(&Columns::close); }
+    ColumnView<double> volumes() const { return view(&Columns::volume); }
+    ColumnView<std::uint64_t> rowSequences() const { return view(&Columns::rowSequence); }
+
+private:
+    // Storage shared by the versions of a series. Each column is allocated at its
+    // full size up front and rows are written in place up to capacity().
+    struct Columns
+    {
+        explicit Columns(std::size_t rows);
+
+        // Rows that fit, leaving a chunk of padding after the last
+        std::size_t capacity() const { return timestamps.size() - CHUNK_ELEMENTS; }
+
+        AlignedVector<Timestamp> timestamps;
+        AlignedVector<double> open;
+        AlignedVector<double> high;
+        AlignedVector<double> low;
+        AlignedVector<double> close;
+        AlignedVector<double> volume;
+        AlignedVector<std::uint64_t> rowSequence;
+        std::size_t used = 0; // Rows written; only the version ending here may write more
+    };
+
+    template <typename T>
+    ColumnView<T> view(AlignedVector<T> Columns::*column) const
+    {
+        return m_columns ? ColumnView<T>((m_columns.get()->*column).data() + m_begin, m_size) : ColumnView<T>();
+    }
+
+    // True if `rows` more rows can be written after this version's last row without
+    // moving it. Storage other copies use only qualifies when shareStorage is set.
+    bool canAppendInPlace(std::size_t rows, bool shareStorage) const;
+    // Moves the rows to new storage with room for `rows` rows
+    void relocate(std::size_t rows);
+    // Both write after the last row and need the room already made
+    void pushRow(const MarketDataEntry &entry, std::uint64_t rowSequence);
+    void appendRows(const ColumnarSeries &source, std::size_t from, std::size_t to);
+    // Drops the oldest rows beyond maxRows (0 keeps every row); returns how many
+    std::size_t trimTo(std::size_t maxRows);
+    bool sameValues(std::size_t i, const MarketDataEntry &entry) const;
+
+    template <bool Build>
+    static SeriesUpdate mergeRows(const ColumnarSeries &base, const std::vector<MarketDataEntry> &incoming, ColumnarSeries &out);
+    // merge() for bars that all sort after base's last one
+    static SeriesUpdate appendNewer(const ColumnarSeries &base, const std::vector<MarketDataEntry> &incoming, ColumnarSeries &out,
+                                    std::size_t maxRows);
+
+    std::uint64_t m_sequence = 0;
+    std::shared_ptr<Columns> m_columns;
+    std::size_t m_begin = 0;        // This version's first row in m_columns
+    std::size_t m_size = 0;
+    std::size_t m_firstChanged = 0; // No row before this one was written at m_sequence
+};
+
+// Serializes as the same JSON array of row objects as std::vector<MarketDataEntry>
+void to_json(nlohmann::json &j, const ColumnarSeries &series);
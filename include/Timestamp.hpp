@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Fixed-size point in time: nanoseconds since the Unix epoch (UTC).
+ *
+ * Replaces per-row timestamp strings so entries stay trivially copyable and
+ * ordering is a single integer compare. Text is only produced at the edges:
+ * JSON frames and the GUI keep the Alpha Vantage "YYYY-MM-DD HH:MM:SS" form,
+ * logs and tools use ISO-8601 with a 'T'.
+ */
+struct Timestamp
+{
+    std::int64_t m_nanos = 0;
+
+    // Longest output of format(): "YYYY-MM-DDTHH:MM:SS.nnnnnnnnn"
+    static constexpr std::size_t MAX_FORMATTED_LENGTH = 29;
+
+    constexpr Timestamp() = default;
+    constexpr explicit Timestamp(std::int64_t nanos) : m_nanos(nanos) {}
+
+    // Accepts "YYYY-MM-DDTHH:MM:SS" or "YYYY-MM-DD HH:MM:SS" (Alpha Vantage),
+    // optionally followed by a fraction of up to nine digits. Returns false on malformed input.
+    static bool parse(std::string_view text, Timestamp &out);
+
+    // Separator between date and time in the text written at the JSON and GUI edges
+    static constexpr char EDGE_SEPARATOR = ' ';
+
+    // Writes "YYYY-MM-DDTHH:MM:SS" plus a fraction only when it is non-zero, with `separator`
+    // in place of the 'T'; returns the length written
+    std::size_t format(char *out, char separator = 'T') const;
+    std::string toString(char separator = 'T') const;
+
+    friend constexpr bool operator==(Timestamp a, Timestamp b) { return a.m_nanos == b.m_nanos; }
+    friend constexpr bool operator!=(Timestamp a, Timestamp b) { return a.m_nanos != b.m_nanos; }
+    friend constexpr bool operator<(Timestamp a, Timestamp b) { return a.m_nanos < b.m_nanos; }
+    friend constexpr bool operator>(Timestamp a, Timestamp b) { return a.m_nanos > b.m_nanos; }
+    friend constexpr bool operator<=(Timestamp a, Timestamp b) { return a.m_nanos <= b.m_nanos; }
+    friend constexpr bool operator>=(Timestamp a, Timestamp b) { return a.m_nanos >= b.m_nanos; }
+};
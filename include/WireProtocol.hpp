@@ -0,0 +1,124 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DataParser.hpp"
+
+/**
+ * @brief Framing shared by the server and its clients.
+ *
+ * Every message is a text header line, optionally followed by a payload of
+ * the size the header announces:
+ *
+ *   DATA_SIZE:<bytes>\n<json rows>                         full history (default mode)
+ *   SNAPSHOT:<symbol>:<seq>:<bytes>\n<json rows>           full history at seq (delta mode)
+ *   UPDATE:<symbol>:<prevSeq>:<seq>:<first>:<bytes>\n<json rows>
+ *                                                          bars changed after prevSeq, up to seq (delta mode)
+ *   HELLO:<options>\n                                      options the server accepted
+ *   ERROR:<message>\n
+ *   STATS:<bytes>\n<json object>                          reply to the STATS admin command, when enabled
+ *
+ * Clients opt into delta mode with "HELLO DELTA". A client that holds
+ * sequence S and receives an UPDATE whose prevSeq is greater than S has
+ * missed bars and sends "RESYNC <symbol>" to get a fresh SNAPSHOT. The
+ * server also sends an unrequested SNAPSHOT when it replaces a series rather
+ * than merging into it, e.g. when a symbol switches between API and CSV data.
+ * An UPDATE's first is the timestamp, in nanoseconds, of the oldest bar the
+ * server still holds; bars before it were dropped by the row limit and the
+ * client drops them too.
+ *
+ * "HELLO BINARY" switches every server frame after the HELLO reply to the
+ * binary framing: a fixed BINARY_HEADER_SIZE header followed by payloadSize
+ * bytes. All integers are little-endian.
+ *
+ *   offset  0  u8   magic (BINARY_MAGIC)
+ *           1  u8   frame type (FrameType)
+ *           2  u16  reserved, zero
+ *           4  u32  symbol id
+ *           8  u32  record count
+ *          12  u32  payload bytes
+ *          16  u64  previous sequence (Update only)
+ *          24  u64  sequence (Snapshot and Update)
+ *          32  i64  first timestamp nanoseconds (Update only), as in UPDATE
+ *
+ * Data, Snapshot and Update payloads are count packed BINARY_RECORD_SIZE
+ * records: i64 timestamp nanoseconds, then f64 open, high, low, close and
+ * volume. A Symbol frame, whose payload is the symbol name, binds an id
+ * before that id is first used. Error payloads are the message text and
+ * Stats payloads the same JSON object as in text mode.
+ * Commands from the client stay text lines in both modes.
+ */
+namespace WireProtocol
+{
+    enum class FrameType
+    {
+        Data,
+        Snapshot,
+        Update,
+        Hello,
+        Error,
+        Symbol, // Binary mode only: binds symbolId to the name in the payload
+        Stats   // Server statistics as a JSON object
+    };
+
+    constexpr std::uint8_t BINARY_MAGIC = 0xFB;
+    constexpr std::size_t BINARY_HEADER_SIZE = 40;
+    constexpr std::size_t BINARY_RECORD_SIZE = 48;
+
+    struct FrameHeader
+    {
+        FrameType type = FrameType::Data;
+        std::string symbol;
+        std::uint64_t previousSequence = 0;
+        std::uint64_t sequence = 0;
+        std::size_t payloadSize = 0;
+        std::string text;            // HELLO options or ERROR message
+        std::uint32_t symbolId = 0;  // Binary frames name their symbol by id
+        std::uint32_t count = 0;     // Binary frames: number of records in the payload
+        Timestamp firstTimestamp;    // Update: the server's oldest bar; local bars before it are dropped
+    };
+
+    // One encoded frame, shared read-only by every connection it is sent to
+    struct EncodedFrame
+    {
+        std::string header;
+        std::string payload;
+        // Binary frames that refer to a symbol id; a connection that has not
+        // seen the id yet gets a Symbol frame binding it to symbol first
+        std::optional<std::uint32_t> symbolId;
+        std::string symbol; // Symbol whose bars the frame carries; empty for HELLO/ERROR
+        // LatencyRecorder::now() when the update it carries arrived upstream; 0 if it is not an update
+        std::int64_t origin = 0;
+    };
+    using SharedFrame = std::shared_ptr<const EncodedFrame>;
+
+    std::string makeDataHeader(std::size_t payloadSize);
+    std::string makeSnapshotHeader(const std::string &symbol, std::uint64_t sequence, std::size_t payloadSize);
+    std::string makeUpdateHeader(const std::string &symbol, std::uint64_t previousSequence, std::uint64_t sequence,
+                                 Timestamp firstTimestamp, std::size_t payloadSize);
+    std::string makeStatsHeader(std::size_t payloadSize);
+
+    // Parses a header line without its trailing '\n'. Returns false for unknown or malformed headers.
+    bool parseFrameHeader(std::string_view line, FrameHeader &out);
+
+    // Binary framing. makeBinaryHeader returns exactly BINARY_HEADER_SIZE bytes.
+    std::string makeBinaryHeader(FrameType type, std::uint32_t symbolId, std::uint32_t count,
+                                 std::uint64_t previousSequence, std::uint64_t sequence, std::size_t payloadSize,
+                                 Timestamp firstTimestamp = Timestamp());
+    // Reads BINARY_HEADER_SIZE bytes. Returns false on a bad magic byte or unknown type.
+    bool parseBinaryHeader(const char *data, FrameHeader &out);
+
+    void appendBinaryRecord(std::string &out, const MarketDataEntry &entry);
+    void encodeBinaryRecords(const std::vector<MarketDataEntry> &rows, std::string &out);
+    // Appends the records in payload to out. Returns false if payload is not a whole number of records.
+    bool decodeBinaryRecords(std::string_view payload, std::vector<MarketDataEntry> &out);
+
+    // Merges timestamp-sorted delta rows into a timestamp-sorted local copy,
+    // replacing rows with equal timestamps and inserting new ones, then drops
+    // the rows before firstTimestamp that the server no longer holds.
+    void applyDelta(std::vector<MarketDataEntry> &local, const std::vector<MarketDataEntry> &delta, Timestamp firstTimestamp);
+}
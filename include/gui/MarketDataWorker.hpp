@@ -2,16 +2,26 @@
 
 #include <QObject>
 #include <QString>
+#include <chrono>
+#include <utility> // Must precede Asio in C++20 builds (Boost 1.74)
 #include <vector>
 #include <memory>
 #include <thread>           
 #include <atomic>           
+#include <deque>
+#include <functional>
+#include <unordered_map>
 #include "DataParser.hpp"
+#include "WireProtocol.hpp"
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/streambuf.hpp>
 #include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/steady_timer.hpp>
+#ifdef FLASHFEED_USE_COROUTINES
+#include <boost/asio/awaitable.hpp>
+#endif
 
 namespace net = boost::asio; 
 using tcp = net::ip::tcp;    
@@ -40,28 +50,79 @@ private:
     std::shared_ptr<tcp::socket> m_socket; 
     tcp::resolver m_resolver;
     net::streambuf m_responseBuffer; 
+    net::steady_timer m_connectTimer;
+    net::steady_timer m_writeTimer;
 
     // State members
     bool m_isConnected;
     QString m_currentSymbol; 
 
+    // Local copy of each subscribed symbol, kept current by applying delta frames
+    struct SymbolState
+    {
+        std::vector<MarketDataEntry> entries;
+        std::uint64_t sequence = 0;
+        bool haveSnapshot = false;
+        bool resyncRequested = false;
+    };
+    std::unordered_map<std::string, SymbolState> m_symbolStates;
+    WireProtocol::FrameHeader m_pendingFrame; // Header whose payload is being read
+    bool m_binaryMode = false;                // Server accepted HELLO BINARY; frames after the reply are binary
+    std::unordered_map<std::uint32_t, std::string> m_symbolNames; // Binary symbol ids learned from Symbol frames
+
+    // Commands waiting to be written; only the front one is in flight
+    struct OutgoingMessage
+    {
+        std::string text;
+        std::function<void()> onSent;
+    };
+    std::deque<OutgoingMessage> m_writeQueue;
+
     // Thread for running io_context
     std::thread m_asioThread;                    
     std::atomic<bool> m_asioThreadShouldExit;
 
-    // Private methods for asynchronous operations
+    // Deadlines for socket operations; on expiry the socket is closed and the
+    // pending read reports the disconnect
+    static constexpr std::chrono::seconds CONNECT_TIMEOUT{10};
+    static constexpr std::chrono::seconds WRITE_TIMEOUT{10};
+
+    // Private methods for asynchronous operations. With FLASHFEED_USE_COROUTINES the
+    // connect, read and write sequences are Asio coroutines, otherwise chained handlers.
+    void queueWrite(std::string text, std::function<void()> onSent = {});
+#ifdef FLASHFEED_USE_COROUTINES
+    net::awaitable<void> connectAndRead(std::string host, std::string port);
+    net::awaitable<void> readFrames();
+    net::awaitable<void> fillBuffer(std::size_t size, boost::system::error_code& ec);
+    net::awaitable<void> writeQueued();
+#else
     void doResolve(const QString &address, const QString &portStr);
     void doConnect(const tcp::resolver::results_type& endpoints);
-    void doWriteSubscribe();
+    void doWrite();
     void doReadHeader();
     void doReadPayload(std::size_t payloadSize);
 
     void handleResolve(const boost::system::error_code& ec,
                        const tcp::resolver::results_type& endpoints);
     void handleConnect(const boost::system::error_code& ec);
-    void handleWriteSubscribe(const boost::system::error_code& ec, std::size_t bytes_transferred);
+    void handleWrite(const boost::system::error_code& ec, std::size_t bytes_transferred);
     void handleReadHeader(const boost::system::error_code& ec, std::size_t bytes_transferred);
+    void handleReadBinaryHeader(const boost::system::error_code& ec, std::size_t bytes_transferred);
     void handleReadPayload(const boost::system::error_code& ec, std::size_t bytes_transferred, std::size_t expectedPayloadSize);
+#endif
+    bool onResolved(const boost::system::error_code& ec);
+    bool onConnected(const boost::system::error_code& ec);
+    bool onWritten(const boost::system::error_code& ec);
+    void armTimeout(net::steady_timer& timer, std::chrono::seconds timeout, const char* operation);
+
+    // Take one frame out of m_responseBuffer once enough bytes are buffered.
+    // consumeHeaderLine returns true when a payload of m_pendingFrame.payloadSize
+    // follows; consumeBinaryHeader returns false for a header that cannot be framed.
+    bool consumeHeaderLine();
+    bool consumeBinaryHeader();
+    void consumePayload(std::size_t payloadSize);
+    void handleBinaryPayload(const std::string& payload);
+    void handleFrame(const WireProtocol::FrameHeader& header, std::vector<MarketDataEntry> rows);
     void closeSocket();
     using work_guard_type = net::executor_work_guard<net::io_context::executor_type>;
     std::unique_ptr<work_guard_type> m_workGuard;
@@ -8,7 +8,7 @@
 using json = nlohmann::json;
 
 AppConfig ConfigLoader::loadConfig(const std::string& filePath) {
-    Logger::getInstance().log("Attempting to load configuration from: " + filePath, Logger::LogLevel::INFO);
+    FLASHFEED_LOG_INFO("Attempting to load configuration from: {}", filePath);
 
     if (!std::filesystem::exists(filePath)) {
          throw std::runtime_error("Configuration file not found: " + filePath);
@@ -42,6 +42,55 @@ AppConfig ConfigLoader::loadConfig(const std::string& filePath) {
             config.serverConfig.apiFunction = serverJson.value("api_function", config.serverConfig.apiFunction);
             config.serverConfig.apiInterval = serverJson.value("api_interval", config.serverConfig.apiInterval);
 
+            auto &fetch = config.serverConfig.fetch;
+            fetch.port = serverJson.value("api_port", fetch.port);
+            fetch.useTls = serverJson.value("api_use_tls", fetch.useTls);
+            fetch.reuseConnections = serverJson.value("api_keep_alive", fetch.reuseConnections);
+            fetch.conditionalRequests = serverJson.value("api_conditional_requests", fetch.conditionalRequests);
+            fetch.maxConcurrent = serverJson.value("max_concurrent_fetches", fetch.maxConcurrent);
+            if (fetch.maxConcurrent == 0) {
+                FLASHFEED_LOG_WARNING("Invalid 'max_concurrent_fetches' 0. Using 1.");
+                fetch.maxConcurrent = 1;
+            }
+            fetch.timeout = std::chrono::seconds(serverJson.value("fetch_timeout_seconds", static_cast<long>(fetch.timeout.count())));
+            if (fetch.timeout.count() <= 0) {
+                FLASHFEED_LOG_WARNING("Invalid 'fetch_timeout_seconds' <= 0. Using default 15.");
+                fetch.timeout = std::chrono::seconds(15);
+            }
+            if (serverJson.contains("symbol_refresh_seconds")) {
+                for (auto& [symbol, seconds] : serverJson["symbol_refresh_seconds"].items()) {
+                    if (seconds.is_number_integer() && seconds.get<int>() > 0) {
+                        config.serverConfig.symbolRefreshSeconds[symbol] = seconds.get<int>();
+                    } else {
+                        FLASHFEED_LOG_WARNING("Ignoring invalid refresh interval for {}.", symbol);
+                    }
+                }
+            }
+
+            config.serverConfig.ioThreads = serverJson.value("io_threads", config.serverConfig.ioThreads);
+
+            auto &sendQueue = config.serverConfig.sendQueue;
+            sendQueue.maxDepth = serverJson.value("send_queue_depth", sendQueue.maxDepth);
+            if (sendQueue.maxDepth == 0) {
+                FLASHFEED_LOG_WARNING("Invalid 'send_queue_depth' 0. Using 1.");
+                sendQueue.maxDepth = 1;
+            }
+            const std::string policyName = serverJson.value("slow_consumer_policy", std::string(MarketDataServer::slowConsumerPolicyName(sendQueue.policy)));
+            if (!MarketDataServer::parseSlowConsumerPolicy(policyName, sendQueue.policy)) {
+                FLASHFEED_LOG_WARNING("Unknown 'slow_consumer_policy' '{}'. Using {}.", policyName,
+                                      MarketDataServer::slowConsumerPolicyName(sendQueue.policy));
+            }
+
+            auto &timeouts = config.serverConfig.timeouts;
+            timeouts.idle = std::chrono::seconds(serverJson.value("idle_timeout_seconds", static_cast<long>(timeouts.idle.count())));
+            timeouts.write = std::chrono::seconds(serverJson.value("write_timeout_seconds", static_cast<long>(timeouts.write.count())));
+
+            auto &latencyReport = config.serverConfig.latencyReportInterval;
+            latencyReport = std::chrono::seconds(serverJson.value("latency_report_seconds", static_cast<long>(latencyReport.count())));
+            config.serverConfig.statsCommandEnabled = serverJson.value("stats_command_enabled", config.serverConfig.statsCommandEnabled);
+
+            config.serverConfig.maxBarsPerSymbol = serverJson.value("max_bars_per_symbol", config.serverConfig.maxBarsPerSymbol);
+
             if (serverJson.contains("csv_fallback_paths")) {
                 config.serverConfig.symbolCSVPaths.clear();
                 const auto& pathsJson = serverJson["csv_fallback_paths"];
@@ -49,7 +98,7 @@ AppConfig ConfigLoader::loadConfig(const std::string& filePath) {
                 // Project root is likely the parent dir of the 'input' dir where config lives
                 std::filesystem::path config_dir = config_file_path_obj.parent_path();
                 std::filesystem::path project_root_dir = config_dir.parent_path(); // Go up one more level
-                Logger::getInstance().log("Assuming project root for CSV paths: " + project_root_dir.string(), Logger::LogLevel::INFO);
+                FLASHFEED_LOG_INFO("Assuming project root for CSV paths: {}", project_root_dir.string());
 
 
                 for (auto& [symbol, path_json] : pathsJson.items()) {
@@ -60,27 +109,53 @@ AppConfig ConfigLoader::loadConfig(const std::string& filePath) {
 
                          config.serverConfig.symbolCSVPaths[symbol] = absolute_csv_path.string();
 
-                         Logger::getInstance().log("Resolved CSV path for " + symbol + ": " + absolute_csv_path.string(), Logger::LogLevel::INFO);
+                         FLASHFEED_LOG_INFO("Resolved CSV path for {}: {}", symbol, absolute_csv_path.string());
                      } else { 
-                        Logger::getInstance().log("No 'csv_fallback_paths' found in server config.", Logger::LogLevel::WARNING);
+                        FLASHFEED_LOG_WARNING("No 'csv_fallback_paths' found in server config.");
                         config.serverConfig.symbolCSVPaths.clear();
                       }
                 }
             } else {  }
 
+            if (serverJson.contains("snapshot_dir")) {
+                // Relative to the project root, like the CSV paths
+                std::filesystem::path snapshot_dir = serverJson["snapshot_dir"].get<std::string>();
+                if (!snapshot_dir.empty()) {
+                    snapshot_dir = std::filesystem::absolute(config_file_path_obj.parent_path().parent_path() / snapshot_dir).lexically_normal();
+                }
+                config.serverConfig.snapshotDirectory = snapshot_dir.string();
+            }
+
+            if (serverJson.contains("replay")) {
+                const auto& replayJson = serverJson["replay"];
+                auto &replay = config.serverConfig.replay;
+                replay.enabled = replayJson.value("enabled", replay.enabled);
+                replay.speed = replayJson.value("speed", replay.speed);
+                if (replay.speed < 0) {
+                    FLASHFEED_LOG_WARNING("Invalid replay 'speed' < 0. Using 1.");
+                    replay.speed = 1.0;
+                }
+                replay.startDelay = std::chrono::seconds(replayJson.value("start_delay_seconds", static_cast<long>(replay.startDelay.count())));
+                replay.reportInterval = std::chrono::seconds(replayJson.value("report_interval_seconds", static_cast<long>(replay.reportInterval.count())));
+                if (replay.reportInterval.count() <= 0) {
+                    FLASHFEED_LOG_WARNING("Invalid replay 'report_interval_seconds' <= 0. Using default 5.");
+                    replay.reportInterval = std::chrono::seconds(5);
+                }
+            }
+
             if (config.serverConfig.apiKey.empty()) {  throw std::runtime_error("Server 'api_key' cannot be empty."); }
             if (config.serverConfig.apiRefreshSeconds <= 0) {
-                Logger::getInstance().log("Invalid 'api_refresh_seconds' <= 0. Using default 60.", Logger::LogLevel::WARNING);
+                FLASHFEED_LOG_WARNING("Invalid 'api_refresh_seconds' <= 0. Using default 60.");
                 config.serverConfig.apiRefreshSeconds = 60; // Reset to default
            }
         } else { 
-            Logger::getInstance().log("Configuration file missing 'server' section. Using defaults.", Logger::LogLevel::WARNING);
+            FLASHFEED_LOG_WARNING("Configuration file missing 'server' section. Using defaults.");
          }
 
         config.clientServerAddress = configJson.value("/client/server_address"_json_pointer, config.clientServerAddress);
 
     } catch (const json::exception& e) {  }
 
-    Logger::getInstance().log("Configuration loaded successfully.", Logger::LogLevel::INFO);
+    FLASHFEED_LOG_INFO("Configuration loaded successfully.");
     return config;
 }
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "CsvFallbackCache.hpp"
+#include "Logger.hpp"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/stat.h>
+#define FLASHFEED_HAS_STAT 1
+#else
+#include <chrono>
+#include <filesystem>
+#endif
+
+bool CsvFallbackCache::stampFile(const std::string &path, FileStamp &stamp)
+{
+#ifdef FLASHFEED_HAS_STAT
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0)
+    {
+        return false;
+    }
+#ifdef __APPLE__
+    const struct timespec &modified = info.st_mtimespec;
+#else
+    const struct timespec &modified = info.st_mtim;
+#endif
+    stamp.device = static_cast<std::uint64_t>(info.st_dev);
+    stamp.inode = static_cast<std::uint64_t>(info.st_ino);
+    stamp.size = static_cast<std::uint64_t>(info.st_size);
+    stamp.modifiedNs = static_cast<std::int64_t>(modified.tv_sec) * 1000000000LL + modified.tv_nsec;
+    return true;
+#else
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec)
+    {
+        return false;
+    }
+    auto modified = std::filesystem::last_write_time(path, ec);
+    if (ec)
+    {
+        return false;
+    }
+    stamp.size = static_cast<std::uint64_t>(size);
+    stamp.modifiedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(modified.time_since_epoch()).count();
+    return true;
+#endif
+}
+
+CsvFallbackCache::Entry CsvFallbackCache::load(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    FileStamp stamp;
+    const bool exists = stampFile(path, stamp);
+    auto it = m_files.find(path);
+    if (it != m_files.end() && (!exists || it->second.stamp == stamp))
+    {
+        return it->second.entry;
+    }
+
+    CachedFile &cached = m_files[path];
+    cached.stamp = stamp;
+    cached.entry.version = m_nextVersion++;
+    cached.entry.bars.reset();
+    ++m_parses;
+
+    auto parser = ParserFactory::createCSVParser(path, MappedFile::Mode::Copy);
+    if (parser->parseData())
+    {
+        cached.entry.bars = std::make_shared<const std::vector<MarketDataEntry>>(parser->getData());
+        FLASHFEED_LOG_INFO("Loaded CSV fallback data from {}: {} bars", path, cached.entry.bars->size());
+    }
+    return cached.entry;
+}
+
+std::size_t CsvFallbackCache::parses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_parses;
+}
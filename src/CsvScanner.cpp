@@ -0,0 +1,179 @@
+#include "CsvScanner.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define FLASHFEED_X86_SIMD 1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define FLASHFEED_TARGET_AVX2 __attribute__((target("avx2")))
+#define FLASHFEED_CTZ(x) __builtin_ctz(x)
+#else
+#include <intrin.h>
+#define FLASHFEED_TARGET_AVX2
+inline unsigned flashfeedCtz(unsigned x)
+{
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return static_cast<unsigned>(index);
+}
+#define FLASHFEED_CTZ(x) flashfeedCtz(x)
+#endif
+
+namespace
+{
+    using CsvScanner::StructuralIndex;
+
+    inline void recordDelimiter(StructuralIndex &index, std::uint32_t offset, bool isNewline)
+    {
+        index.delimiters.push_back(offset);
+        if (isNewline)
+        {
+            index.rowEnds.push_back(static_cast<std::uint32_t>(index.delimiters.size()));
+        }
+    }
+
+    // Handles the bytes [from, size) one at a time; also used for SIMD tails
+    void scanScalar(const char *data, std::size_t from, std::size_t size, StructuralIndex &index)
+    {
+        for (std::size_t i = from; i < size; ++i)
+        {
+            const char c = data[i];
+            if (c == ',' || c == '\n')
+            {
+                recordDelimiter(index, static_cast<std::uint32_t>(i), c == '\n');
+            }
+        }
+    }
+
+    // Walks the set bits of a block's delimiter mask in offset order
+    inline void recordMask(StructuralIndex &index, std::size_t blockStart, unsigned mask, unsigned newlineMask)
+    {
+        while (mask != 0)
+        {
+            const unsigned bit = FLASHFEED_CTZ(mask);
+            recordDelimiter(index, static_cast<std::uint32_t>(blockStart + bit), (newlineMask >> bit) & 1u);
+            mask &= mask - 1;
+        }
+    }
+
+#ifdef FLASHFEED_X86_SIMD
+    std::size_t scanSSE2(const char *data, std::size_t size, StructuralIndex &index)
+    {
+        const __m128i commas = _mm_set1_epi8(',');
+        const __m128i newlines = _mm_set1_epi8('\n');
+        std::size_t i = 0;
+        for (; i + 16 <= size; i += 16)
+        {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            const unsigned commaMask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, commas)));
+            const unsigned newlineMask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newlines)));
+            recordMask(index, i, commaMask | newlineMask, newlineMask);
+        }
+        return i;
+    }
+
+    FLASHFEED_TARGET_AVX2 std::size_t scanAVX2(const char *data, std::size_t size, StructuralIndex &index)
+    {
+        const __m256i commas = _mm256_set1_epi8(',');
+        const __m256i newlines = _mm256_set1_epi8('\n');
+        std::size_t i = 0;
+        for (; i + 32 <= size; i += 32)
+        {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            const unsigned commaMask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, commas)));
+            const unsigned newlineMask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newlines)));
+            recordMask(index, i, commaMask | newlineMask, newlineMask);
+        }
+        return i;
+    }
+#endif
+}
+
+namespace CsvScanner
+{
+    bool isKernelSupported(Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case Kernel::Scalar:
+            return true;
+#ifdef FLASHFEED_X86_SIMD
+        case Kernel::SSE2:
+            return true; // Baseline on x86-64
+        case Kernel::AVX2:
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+#endif
+        default:
+            return false;
+        }
+    }
+
+    Kernel bestKernel()
+    {
+        static const Kernel best = isKernelSupported(Kernel::AVX2)   ? Kernel::AVX2
+                                   : isKernelSupported(Kernel::SSE2) ? Kernel::SSE2
+                                                                     : Kernel::Scalar;
+        return best;
+    }
+
+    const char *kernelName(Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case Kernel::Scalar:
+            return "scalar";
+        case Kernel::SSE2:
+            return "sse2";
+        case Kernel::AVX2:
+            return "avx2";
+        }
+        return "unknown";
+    }
+
+    bool buildIndex(std::string_view buffer, StructuralIndex &index)
+    {
+        return buildIndex(buffer, index, bestKernel());
+    }
+
+    bool buildIndex(std::string_view buffer, StructuralIndex &index, Kernel kernel)
+    {
+        index.clear();
+        if (buffer.size() > MAX_INDEXED_BYTES || !isKernelSupported(kernel))
+        {
+            return false;
+        }
+
+        // Numeric CSV rows run ~8 bytes per field, so this avoids most regrowth
+        index.delimiters.reserve(buffer.size() / 8 + 1);
+        index.rowEnds.reserve(buffer.size() / 48 + 1);
+
+        const char *data = buffer.data();
+        std::size_t scanned = 0;
+        switch (kernel)
+        {
+#ifdef FLASHFEED_X86_SIMD
+        case Kernel::AVX2:
+            scanned = scanAVX2(data, buffer.size(), index);
+            break;
+        case Kernel::SSE2:
+            scanned = scanSSE2(data, buffer.size(), index);
+            break;
+#endif
+        default:
+            break;
+        }
+        scanScalar(data, scanned, buffer.size(), index);
+
+        // Close an unterminated last row
+        if (!buffer.empty() && buffer.back() != '\n')
+        {
+            index.rowEnds.push_back(static_cast<std::uint32_t>(index.delimiters.size()));
+        }
+        return true;
+    }
+}
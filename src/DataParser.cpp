@@ -1,25 +1,131 @@
 #include "DataParser.hpp"
 #include "Logger.hpp"
-#include "BenchMark.hpp"
+#include "MappedFile.hpp"
+#include "CsvScanner.hpp"
+#include "JsonBarParser.hpp"
 #include <algorithm> // for std::min
-#include <nlohmann/json.hpp>
+#include <charconv>
 #include <vector>   
 #include <string>    
 #include <sstream>   
 #include <fstream>   
+#include <utility>
 
-// Used for Json parsing
-using json = nlohmann::json;
 // constexpr const int NUMELEMENTS = 10000;
 
 bool compareMarketDataEntryTimestamps(const MarketDataEntry& a, const MarketDataEntry& b) {
     return a.m_timestamp < b.m_timestamp;
 }
 
+namespace
+{
+    constexpr std::size_t CSV_COMMAS_PER_ROW = 5; // timestamp,open,high,low,close,volume
+
+    bool parseNumber(const char* begin, const char* end, double& out)
+    {
+        auto [ptr, ec] = std::from_chars(begin, end, out);
+        return ec == std::errc() && ptr == end && begin != end;
+    }
+
+    // Parses the row [rowStart, rowEnd) of data given the offsets of its five commas
+    bool parseCSVFields(const char* data, std::size_t rowStart, const std::uint32_t* commas, std::size_t rowEnd, MarketDataEntry& entry)
+    {
+        if (rowEnd > rowStart && data[rowEnd - 1] == '\r') {
+            --rowEnd;
+        }
+        if (!Timestamp::parse(std::string_view(data + rowStart, commas[0] - rowStart), entry.m_timestamp) ||
+            !parseNumber(data + commas[0] + 1, data + commas[1], entry.m_open) ||
+            !parseNumber(data + commas[1] + 1, data + commas[2], entry.m_high) ||
+            !parseNumber(data + commas[2] + 1, data + commas[3], entry.m_low) ||
+            !parseNumber(data + commas[3] + 1, data + commas[4], entry.m_close) ||
+            !parseNumber(data + commas[4] + 1, data + rowEnd, entry.m_volume)) {
+            return false;
+        }
+        return true;
+    }
+
+    void logBadLine(const char* begin, const char* end)
+    {
+        FLASHFEED_LOG_WARNING("Bad Line: {}", std::string_view(begin, static_cast<std::size_t>(end - begin)));
+    }
+
+    // Parses every row after the header using a prebuilt structural index
+    void parseIndexedRows(std::string_view content, const CsvScanner::StructuralIndex& index, std::vector<MarketDataEntry>& out)
+    {
+        const char* data = content.data();
+        const std::uint32_t* delimiters = index.delimiters.data();
+        out.reserve(index.rowEnds.size());
+
+        for (std::size_t row = 1; row < index.rowEnds.size(); ++row) { // Row 0 is the header
+            const std::size_t first = index.rowEnds[row - 1];
+            const std::size_t last = index.rowEnds[row];
+            const std::size_t rowStart = delimiters[first - 1] + 1;
+            const bool terminated = last > first && data[delimiters[last - 1]] == '\n';
+            const std::size_t rowEnd = terminated ? delimiters[last - 1] : content.size();
+            const std::size_t commaCount = (last - first) - (terminated ? 1 : 0);
+
+            if (rowEnd == rowStart || (rowEnd == rowStart + 1 && data[rowStart] == '\r')) {
+                continue; // Blank line
+            }
+
+            MarketDataEntry entry;
+            if (commaCount == CSV_COMMAS_PER_ROW && parseCSVFields(data, rowStart, delimiters + first, rowEnd, entry)) {
+                out.push_back(entry);
+            }
+            else {
+                logBadLine(data + rowStart, data + rowEnd);
+            }
+        }
+    }
+
+    // Line-at-a-time path for buffers too large for a 32-bit structural index
+    void parseRowsByLine(std::string_view rows, std::vector<MarketDataEntry>& out)
+    {
+        while (!rows.empty()) {
+            std::size_t lineEnd = rows.find('\n');
+            std::string_view line = rows.substr(0, lineEnd);
+            rows = (lineEnd == std::string_view::npos) ? std::string_view() : rows.substr(lineEnd + 1);
+
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (line.empty()) {
+                continue;
+            }
+
+            MarketDataEntry entry;
+            if (parseCSVRow(line, entry)) {
+                out.push_back(entry);
+            }
+            else {
+                logBadLine(line.data(), line.data() + line.size());
+            }
+        }
+    }
+}
+
+bool parseCSVRow(std::string_view line, MarketDataEntry& entry)
+{
+    // Expecting format: timestamp,open,high,low,close,volume
+    std::uint32_t commas[CSV_COMMAS_PER_ROW];
+    std::size_t pos = 0;
+    for (auto& comma : commas) {
+        pos = line.find(',', pos);
+        if (pos == std::string_view::npos) {
+            return false;
+        }
+        comma = static_cast<std::uint32_t>(pos++);
+    }
+    if (line.find(',', pos) != std::string_view::npos) {
+        return false;
+    }
+    return parseCSVFields(line.data(), 0, commas, line.size(), entry);
+}
 
 
-DataParserCSVAlphaAPI::DataParserCSVAlphaAPI(const std::string& CSVPath)
-    : m_CSVPath(CSVPath)
+
+DataParserCSVAlphaAPI::DataParserCSVAlphaAPI(const std::string& CSVPath, MappedFile::Mode mode)
+    : m_CSVPath(CSVPath), m_mode(mode)
 {
 }
 
@@ -29,63 +135,46 @@ bool DataParserCSVAlphaAPI::parseData()
     m_data.clear();
         
     try {
-        // Open the file
-        std::ifstream file(m_CSVPath);
-        if (!file.is_open()) {
-            Logger::getInstance().log("File not Open: " + m_CSVPath, Logger::LogLevel::ERROR);
+        // Map the file and scan it in place, no intermediate copies or streams
+        MappedFile file;
+        if (!file.open(m_CSVPath, m_mode)) {
+            FLASHFEED_LOG_ERROR("File not Open: {}", m_CSVPath);
             return false;
         }
-        
-        // Read the entire file into memory for faster processing
-        std::vector<char> buffer(std::istreambuf_iterator<char>(file), {});
-        std::istringstream fileContent(std::string(buffer.data(), buffer.size()));
-        
-        std::string line;
-        
+        std::string_view content = file.view();
+
         // Skip header line
-        if (!std::getline(fileContent, line)) { // Read header
-            Logger::getInstance().log("CSV file is empty or cannot read header.", Logger::LogLevel::ERROR);
+        std::size_t headerEnd = content.find('\n');
+        if (content.empty() || headerEnd == std::string_view::npos) {
+            FLASHFEED_LOG_ERROR("CSV file is empty or cannot read header.");
             return false;
-        }       
-        Logger::getInstance().log("Header Line skipped successfully", Logger::LogLevel::INFO);
-        
-        // Process each line
-        while (std::getline(fileContent, line)) {
-            std::stringstream ss(line);
-            std::string timestamp;
-            double open, high, low, close, volume;
-            
-            // Parse the CSV line - expecting format: timestamp,open,high,low,close,volume
-            if (std::getline(ss, timestamp, ',') && 
-                ss >> open && ss.ignore(1) &&
-                ss >> high && ss.ignore(1) &&
-                ss >> low && ss.ignore(1) &&
-                ss >> close && ss.ignore(1) &&
-                ss >> volume) {
-                
-                m_data.emplace_back(timestamp, open, high, low, close, volume);
-            }
-            else {
-                Logger::getInstance().log("Bad Line: " + line, Logger::LogLevel::WARNING);
-            }
+        }
+        FLASHFEED_LOG_INFO("Header Line skipped successfully");
+
+        // One sweep finds every separator; rows are then parsed field by field
+        CsvScanner::StructuralIndex index;
+        if (CsvScanner::buildIndex(content, index)) {
+            parseIndexedRows(content, index, m_data);
+        }
+        else {
+            parseRowsByLine(content.substr(headerEnd + 1), m_data);
         }
         
         
         // Log successful parsing
-        std::ostringstream logStream;
-        logStream << "Successfully parsed " << m_data.size() << " rows from CSV.";
-        Logger::getInstance().log(logStream.str(), Logger::LogLevel::INFO);
+        FLASHFEED_LOG_INFO("Successfully parsed {} rows from CSV.", m_data.size());
 
-        if (!m_data.empty()) {
-            Logger::getInstance().log("Sorting " + std::to_string(m_data.size()) + " CSV entries by timestamp...", Logger::LogLevel::INFO);
+        // Replay files are written in time order, so only pay for the sort when they are not
+        if (!m_data.empty() && !std::is_sorted(m_data.begin(), m_data.end(), compareMarketDataEntryTimestamps)) {
+            FLASHFEED_LOG_INFO("Sorting {} CSV entries by timestamp...", m_data.size());
             std::sort(m_data.begin(), m_data.end(), compareMarketDataEntryTimestamps);
-            Logger::getInstance().log("CSV data sorted.", Logger::LogLevel::INFO);
+            FLASHFEED_LOG_INFO("CSV data sorted.");
         }
         
         return !m_data.empty();
         
     } catch (const std::exception& e) {
-        Logger::getInstance().log("Error parsing CSV: " + std::string(e.what()), Logger::LogLevel::ERROR);
+        FLASHFEED_LOG_ERROR("Error parsing CSV: {}", e.what());
         return false;
     }
 }
@@ -99,94 +188,31 @@ const std::vector<MarketDataEntry>& DataParserCSVAlphaAPI::getData() const
 // DataParserJsonAlphaAPI Implementation
 //----------------------------------------------
 
-DataParserJsonAlphaAPI::DataParserJsonAlphaAPI(const std::string& jsonContent)
-    : m_jsonContent(jsonContent)
+DataParserJsonAlphaAPI::DataParserJsonAlphaAPI(std::string jsonContent)
+    : m_jsonContent(std::move(jsonContent))
 {
 }
 
 bool DataParserJsonAlphaAPI::parseData() {
-    // Timer timer; timer.start();
     m_data.clear();
-    // m_data.reserve(NUMELEMENTS);
 
-    try {
-        json jsonData = json::parse(m_jsonContent);
-        if (jsonData.contains("Information") || jsonData.contains("Error") || jsonData.contains("Note")) {
-            // ... handle API message, return false ...
-            std::string message;
-            // ... extract message ...
-            Logger::getInstance().log("API message: " + message, Logger::LogLevel::WARNING);
-            return false;
-        }
-
-        // Determine time series key (Daily, 1min, etc.)
-        std::string timeSeriesKey;
-        const std::vector<std::string> possibleKeys = {
-            "Time Series (1min)", "Time Series (5min)", "Time Series (15min)",
-            "Time Series (30min)", "Time Series (60min)", "Time Series (Daily)"
-        };
-        for (const auto& key : possibleKeys) {
-            if (jsonData.contains(key)) {
-                timeSeriesKey = key;
-                break;
-            }
-        }
-
-        if (!timeSeriesKey.empty() && jsonData.contains(timeSeriesKey)) {
-            const auto& timeSeries = jsonData[timeSeriesKey];
-            m_data.reserve(timeSeries.size()); // Reserve based on actual size
-
-            for (auto it = timeSeries.begin(); it != timeSeries.end(); ++it) {
-                const std::string& timestamp = it.key();
-                const auto& dataPoint = it.value();
-                try { // Add try-catch for stod and .at
-                    double open = std::stod(dataPoint.at("1. open").get<std::string>());
-                    double high = std::stod(dataPoint.at("2. high").get<std::string>());
-                    double low = std::stod(dataPoint.at("3. low").get<std::string>());
-                    double close = std::stod(dataPoint.at("4. close").get<std::string>());
-                    double volume = std::stod(dataPoint.at("5. volume").get<std::string>());
-                    m_data.emplace_back(timestamp, open, high, low, close, volume);
-                } catch (const std::exception& ex) { // Catch stod errors or missing keys from .at()
-                     Logger::getInstance().log("Error parsing data point for timestamp " + timestamp + ": " + ex.what(), Logger::LogLevel::WARNING);
-                     // Continue to next data point
-                }
-            }
-        } else if (jsonData.is_array()) { // Fallback for simple array
-            Logger::getInstance().log("Attempting to parse as simple JSON array.", Logger::LogLevel::INFO);
-            m_data.reserve(jsonData.size());
-            for (const auto& entry : jsonData) {
-                if (entry.contains("timestamp") && /* ... other checks ... */ entry.contains("volume")) {
-                    try { // Add try-catch for .at and .get
-                        m_data.emplace_back(
-                            entry.at("timestamp").get<std::string>(),
-                            entry.at("open").get<double>(),
-                            entry.at("high").get<double>(),
-                            entry.at("low").get<double>(),
-                            entry.at("close").get<double>(),
-                            entry.at("volume").get<double>()
-                        );
-                    } catch (const std::exception& ex) {
-                        Logger::getInstance().log("Error parsing array entry: " + std::string(ex.what()), Logger::LogLevel::WARNING);
-                    }
-                }
-            }
-        } else {
-            Logger::getInstance().log("JSON format not recognized as Alpha Vantage API response or simple array.", Logger::LogLevel::WARNING);
-            return false;
-        }
-
-      
-        if (!m_data.empty()) {
-            Logger::getInstance().log("Sorting " + std::to_string(m_data.size()) + " JSON entries by timestamp...", Logger::LogLevel::INFO);
-            std::sort(m_data.begin(), m_data.end(), compareMarketDataEntryTimestamps);
-            Logger::getInstance().log("JSON data sorted.", Logger::LogLevel::INFO);
-        }
-
-
-        return !m_data.empty();
+    JsonBarParser parser(m_data);
+    if (!parser.feed(m_jsonContent) || !parser.finish()) {
+        FLASHFEED_LOG_WARNING("JSON format not recognized as Alpha Vantage API response or simple array.");
+        m_data.clear();
+        return false;
+    }
+    if (!parser.apiMessage().empty()) {
+        FLASHFEED_LOG_WARNING("API message: {}", parser.apiMessage());
+        m_data.clear();
+        return false;
+    }
+    if (parser.skippedBars() > 0) {
+        FLASHFEED_LOG_WARNING("Skipped {} malformed JSON data points", parser.skippedBars());
+    }
 
-    } catch (const json::parse_error& e) {  return false; }
-    catch (const std::exception& e) {  return false; }
+    JsonBarParser::sortByTimestamp(m_data);
+    return !m_data.empty();
 }
 
 const std::vector<MarketDataEntry>& DataParserJsonAlphaAPI::getData() const
@@ -211,20 +237,20 @@ std::unique_ptr<IDataParser> ParserFactory::createParser(const std::string& sour
         return createJSONParser(source);
     }
     else {
-        Logger::getInstance().log("Unknown data format: " + source, Logger::LogLevel::WARNING);
+        FLASHFEED_LOG_WARNING("Unknown data format: {}", source);
         // Default to CSV parser
         return createCSVParser(source);
     }
 }
 
-std::unique_ptr<IDataParser> ParserFactory::createCSVParser(const std::string& filePath)
+std::unique_ptr<IDataParser> ParserFactory::createCSVParser(const std::string& filePath, MappedFile::Mode mode)
 {
-    return std::make_unique<DataParserCSVAlphaAPI>(filePath);
+    return std::make_unique<DataParserCSVAlphaAPI>(filePath, mode);
 }
 
-std::unique_ptr<IDataParser> ParserFactory::createJSONParser(const std::string& jsonContent)
+std::unique_ptr<IDataParser> ParserFactory::createJSONParser(std::string jsonContent)
 {
-    return std::make_unique<DataParserJsonAlphaAPI>(jsonContent);
+    return std::make_unique<DataParserJsonAlphaAPI>(std::move(jsonContent));
 }
 
 
@@ -0,0 +1,567 @@
+#include "FetchScheduler.hpp"
+#include "LatencyHistogram.hpp"
+#include "Logger.hpp"
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <sstream>
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace ssl = net::ssl;
+using tcp = net::ip::tcp;
+
+namespace
+{
+    // Closes a connection without a TLS close_notify exchange. OpenSSL invalidates the
+    // session of a connection freed before it sent close_notify; flagging it as sent
+    // keeps the session resumable for the next connection.
+    void closeQuietly(UpstreamConnectionPool::Stream &stream)
+    {
+        SSL_set_shutdown(stream.native_handle(), SSL_SENT_SHUTDOWN);
+        beast::error_code ec;
+        beast::get_lowest_layer(stream).socket().close(ec);
+    }
+}
+
+std::shared_ptr<ssl::context> CreateClientTlsContext()
+{
+    auto ctx = std::make_shared<ssl::context>(ssl::context::tlsv12_client);
+    ctx->set_default_verify_paths();
+    return ctx;
+}
+
+std::string UpstreamStats::summary() const
+{
+    std::ostringstream out;
+    out << requests << " requests (" << failures << " failed), "
+        << dnsLookups << " DNS lookups, " << connects << " connects, "
+        << fullHandshakes << " full / " << resumedHandshakes << " resumed TLS handshakes, "
+        << reusedConnections << " on reused connections (" << retries << " retried), "
+        << unchanged << " unchanged (" << notModified << " not modified)";
+    if (requests > failures)
+    {
+        auto average = totalLatency / static_cast<long>(requests - failures);
+        out << ", latency avg " << std::chrono::duration_cast<std::chrono::microseconds>(average).count()
+            << " us / max " << std::chrono::duration_cast<std::chrono::microseconds>(maxLatency).count() << " us";
+    }
+    return out.str();
+}
+
+UpstreamConnectionPool::UpstreamConnectionPool(net::io_context &ioc, std::string host, FetchOptions options)
+    : m_ioc(ioc),
+      m_host(std::move(host)),
+      m_options(std::move(options)),
+      m_tls(CreateClientTlsContext())
+{
+}
+
+UpstreamConnectionPool::~UpstreamConnectionPool()
+{
+    closeIdle();
+    if (m_session)
+    {
+        SSL_SESSION_free(m_session);
+    }
+}
+
+std::unique_ptr<UpstreamConnectionPool::Stream> UpstreamConnectionPool::acquire()
+{
+    if (m_idle.empty())
+    {
+        return nullptr;
+    }
+    // Most recently used first: the least likely to have been timed out by the server
+    std::unique_ptr<Stream> stream = std::move(m_idle.back());
+    m_idle.pop_back();
+    return stream;
+}
+
+void UpstreamConnectionPool::release(std::unique_ptr<Stream> stream)
+{
+    if (!m_options.reuseConnections || m_idle.size() >= m_options.maxConcurrent)
+    {
+        closeQuietly(*stream);
+        return;
+    }
+    m_idle.push_back(std::move(stream));
+}
+
+std::unique_ptr<UpstreamConnectionPool::Stream> UpstreamConnectionPool::newStream()
+{
+    auto stream = std::make_unique<Stream>(m_ioc, *m_tls);
+    if (m_options.useTls && m_options.reuseConnections && m_session)
+    {
+        SSL_set_session(stream->native_handle(), m_session);
+    }
+    return stream;
+}
+
+void UpstreamConnectionPool::closeIdle()
+{
+    for (auto &stream : m_idle)
+    {
+        closeQuietly(*stream);
+    }
+    m_idle.clear();
+}
+
+const UpstreamConnectionPool::Endpoints *UpstreamConnectionPool::endpoints() const
+{
+    if (!m_options.reuseConnections || m_endpoints.empty() || std::chrono::steady_clock::now() >= m_endpointsExpiry)
+    {
+        return nullptr;
+    }
+    return &m_endpoints;
+}
+
+void UpstreamConnectionPool::storeEndpoints(Endpoints endpoints)
+{
+    m_endpoints = std::move(endpoints);
+    m_endpointsExpiry = std::chrono::steady_clock::now() + m_options.dnsCacheTtl;
+}
+
+void UpstreamConnectionPool::forgetEndpoints()
+{
+    m_endpoints = Endpoints();
+}
+
+void UpstreamConnectionPool::storeSession(Stream &stream)
+{
+    if (!m_options.reuseConnections)
+    {
+        return;
+    }
+    SSL_SESSION *session = SSL_get1_session(stream.native_handle());
+    if (!session)
+    {
+        return;
+    }
+    if (m_session)
+    {
+        SSL_SESSION_free(m_session);
+    }
+    m_session = session;
+}
+
+UpstreamRequest::UpstreamRequest(UpstreamConnectionPool &pool, std::string target)
+    : m_pool(pool),
+      m_options(pool.options()),
+      m_resolver(pool.context()),
+      m_deadline(pool.context()),
+      m_request(http::verb::get, std::move(target), 11)
+{
+    m_request.set(http::field::host, m_pool.host());
+    m_request.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+    m_request.keep_alive(m_options.reuseConnections);
+}
+
+void UpstreamRequest::setValidators(const std::string &etag, const std::string &lastModified)
+{
+    if (!etag.empty())
+    {
+        m_request.set(http::field::if_none_match, etag);
+    }
+    if (!lastModified.empty())
+    {
+        m_request.set(http::field::if_modified_since, lastModified);
+    }
+}
+
+void UpstreamRequest::start(Handler onDone)
+{
+    m_onDone = std::move(onDone);
+    m_started = std::chrono::steady_clock::now();
+
+    m_deadline.expires_after(m_options.timeout);
+    m_deadline.async_wait([self = shared_from_this()](const boost::system::error_code & /*ec*/)
+                          {
+                              // Cancelled or re-armed since this wait started
+                              if (self->m_deadline.expiry() > std::chrono::steady_clock::now())
+                              {
+                                  return;
+                              }
+                              self->m_timedOut = true;
+                              self->cancel(); });
+
+    if ((m_stream = m_pool.acquire()))
+    {
+        m_reused = true;
+        ++m_pool.stats().reusedConnections;
+        sendRequest();
+        return;
+    }
+    connect();
+}
+
+void UpstreamRequest::cancel()
+{
+    m_resolver.cancel();
+    if (m_stream)
+    {
+        beast::error_code ec;
+        beast::get_lowest_layer(*m_stream).socket().close(ec);
+    }
+}
+
+void UpstreamRequest::connect()
+{
+    m_stream = m_pool.newStream();
+    m_reused = false;
+
+    if (const UpstreamConnectionPool::Endpoints *endpoints = m_pool.endpoints())
+    {
+        onResolved({}, *endpoints);
+        return;
+    }
+    ++m_pool.stats().dnsLookups;
+    m_resolver.async_resolve(m_pool.host(), m_options.port,
+                             [self = shared_from_this()](const boost::system::error_code &ec, tcp::resolver::results_type results)
+                             {
+                                 if (!ec)
+                                 {
+                                     self->m_pool.storeEndpoints(results);
+                                 }
+                                 self->onResolved(ec, std::move(results));
+                             });
+}
+
+void UpstreamRequest::onResolved(const boost::system::error_code &ec, tcp::resolver::results_type results)
+{
+    if (ec)
+    {
+        fail("resolve", ec);
+        return;
+    }
+    beast::get_lowest_layer(*m_stream).async_connect(results,
+                                                     [self = shared_from_this()](const boost::system::error_code &ec, const tcp::endpoint &)
+                                                     { self->onConnected(ec); });
+}
+
+void UpstreamRequest::onConnected(const boost::system::error_code &ec)
+{
+    if (ec)
+    {
+        // The cached address may be stale; resolve again next time
+        m_pool.forgetEndpoints();
+        fail("connect", ec);
+        return;
+    }
+    ++m_pool.stats().connects;
+    // The client Finished of a resumed handshake and the request are small back-to-back
+    // writes; with Nagle on, the request waits for the server's delayed ACK
+    beast::error_code noDelayError;
+    beast::get_lowest_layer(*m_stream).socket().set_option(tcp::no_delay(true), noDelayError);
+    if (!m_options.useTls)
+    {
+        onHandshake({});
+        return;
+    }
+    if (!SSL_set_tlsext_host_name(m_stream->native_handle(), m_pool.host().c_str()))
+    {
+        fail("SNI setup", boost::system::error_code(static_cast<int>(::ERR_get_error()), net::error::get_ssl_category()));
+        return;
+    }
+    m_stream->async_handshake(ssl::stream_base::client,
+                              [self = shared_from_this()](const boost::system::error_code &ec)
+                              { self->onHandshake(ec); });
+}
+
+void UpstreamRequest::onHandshake(const boost::system::error_code &ec)
+{
+    if (ec)
+    {
+        fail("TLS handshake", ec);
+        return;
+    }
+    if (m_options.useTls)
+    {
+        if (SSL_session_reused(m_stream->native_handle()))
+        {
+            ++m_pool.stats().resumedHandshakes;
+        }
+        else
+        {
+            ++m_pool.stats().fullHandshakes;
+        }
+        m_pool.storeSession(*m_stream);
+    }
+    sendRequest();
+}
+
+void UpstreamRequest::sendRequest()
+{
+    // A failed read leaves the response moved-from, so it is rebuilt for every attempt
+    m_response = {};
+    if (m_sink)
+    {
+        m_response.body().sink = [this](std::string_view piece)
+        {
+            m_sinkUsed = true;
+            return m_sink(piece);
+        };
+    }
+    auto onWritten = [self = shared_from_this()](const boost::system::error_code &ec, std::size_t)
+    { self->onWritten(ec); };
+    if (m_options.useTls)
+    {
+        http::async_write(*m_stream, m_request, std::move(onWritten));
+    }
+    else
+    {
+        http::async_write(beast::get_lowest_layer(*m_stream), m_request, std::move(onWritten));
+    }
+}
+
+void UpstreamRequest::onWritten(const boost::system::error_code &ec)
+{
+    if (ec)
+    {
+        if (!retryOnNewConnection(ec))
+        {
+            fail("write", ec);
+        }
+        return;
+    }
+    auto onRead = [self = shared_from_this()](const boost::system::error_code &ec, std::size_t)
+    { self->onRead(ec); };
+    if (m_options.useTls)
+    {
+        http::async_read(*m_stream, m_buffer, m_response, std::move(onRead));
+    }
+    else
+    {
+        http::async_read(beast::get_lowest_layer(*m_stream), m_buffer, m_response, std::move(onRead));
+    }
+}
+
+void UpstreamRequest::onRead(const boost::system::error_code &ec)
+{
+    if (ec)
+    {
+        if (!retryOnNewConnection(ec))
+        {
+            fail("read", ec);
+        }
+        return;
+    }
+
+    UpstreamStats &stats = m_pool.stats();
+    UpstreamResult result;
+    result.ok = m_response.result() == http::status::ok;
+    result.notModified = m_response.result() == http::status::not_modified;
+    if (result.ok)
+    {
+        result.body = std::move(m_response.body().text);
+        result.bodyHash = m_response.body().hash;
+        result.etag = std::string(m_response[http::field::etag]);
+        result.lastModified = std::string(m_response[http::field::last_modified]);
+    }
+    if (result.ok || result.notModified)
+    {
+        auto latency = std::chrono::steady_clock::now() - m_started;
+        stats.totalLatency += latency;
+        stats.maxLatency = std::max<std::chrono::nanoseconds>(stats.maxLatency, latency);
+        LatencyRecorder::getInstance().record(LatencyStage::Fetch, std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+        stats.notModified += result.notModified ? 1 : 0;
+    }
+    else
+    {
+        ++stats.failures;
+        FLASHFEED_LOG_WARNING("Upstream {} answered HTTP {}", m_pool.host(), m_response.result_int());
+    }
+
+    if (m_options.reuseConnections && m_response.keep_alive())
+    {
+        // Back to the pool before the handler runs, so a request it starts can take it
+        m_deadline.expires_at(std::chrono::steady_clock::time_point::max());
+        m_pool.release(std::move(m_stream));
+        finish(std::move(result));
+        return;
+    }
+
+    finish(std::move(result));
+    if (!m_options.useTls)
+    {
+        m_deadline.expires_at(std::chrono::steady_clock::time_point::max());
+        cancel();
+        return;
+    }
+    // The deadline stays armed, so a peer that never answers close_notify cannot hold the request open
+    m_stream->async_shutdown([self = shared_from_this()](const boost::system::error_code & /*ec*/)
+                             {
+                                 // eof and stream_truncated are the usual answers; the data was already delivered
+                                 self->m_deadline.expires_at(std::chrono::steady_clock::time_point::max());
+                                 self->cancel(); });
+}
+
+bool UpstreamRequest::retryOnNewConnection(const boost::system::error_code &ec)
+{
+    // Only an idle connection the server may have dropped in the meantime; never after a timeout or cancel
+    if (!m_reused || m_sinkUsed || m_timedOut || ec == net::error::operation_aborted)
+    {
+        return false;
+    }
+    ++m_pool.stats().retries;
+    closeQuietly(*m_stream);
+    m_buffer.clear();
+    connect();
+    return true;
+}
+
+void UpstreamRequest::fail(const char *operation, const boost::system::error_code &ec)
+{
+    ++m_pool.stats().failures;
+    if (m_timedOut)
+    {
+        FLASHFEED_LOG_ERROR("Upstream request to {} timed out after {}s during {}", m_pool.host(), m_options.timeout.count(), operation);
+    }
+    else if (ec != net::error::operation_aborted)
+    {
+        FLASHFEED_LOG_ERROR("Upstream {} failed for {}: {}", operation, m_pool.host(), ec.message());
+    }
+    m_deadline.expires_at(std::chrono::steady_clock::time_point::max());
+    cancel();
+    finish(UpstreamResult());
+}
+
+void UpstreamRequest::finish(UpstreamResult result)
+{
+    if (!m_onDone)
+    {
+        return;
+    }
+    ++m_pool.stats().requests;
+    Handler onDone = std::move(m_onDone);
+    m_onDone = nullptr;
+    onDone(std::move(result));
+}
+
+FetchScheduler::FetchScheduler(net::io_context &ioc, std::string host, FetchOptions options, ResultHandler onResult)
+    : m_ioc(ioc),
+      m_pool(ioc, std::move(host), std::move(options)),
+      m_onResult(std::move(onResult))
+{
+}
+
+void FetchScheduler::addJob(std::string name, std::string target, std::chrono::seconds interval)
+{
+    m_jobs.push_back(std::make_unique<Job>(m_ioc, std::move(name), std::move(target), interval));
+}
+
+void FetchScheduler::start()
+{
+    for (auto &job : m_jobs)
+    {
+        job->timer.expires_at(std::chrono::steady_clock::now());
+        waitForDue(*job);
+    }
+}
+
+void FetchScheduler::stop()
+{
+    net::post(m_ioc, [this]
+              {
+                  m_stopped = true;
+                  m_ready.clear();
+                  for (auto &job : m_jobs)
+                  {
+                      job->timer.cancel();
+                      if (job->request)
+                      {
+                          job->request->cancel();
+                      }
+                  }
+                  m_pool.closeIdle(); });
+}
+
+void FetchScheduler::waitForDue(Job &job)
+{
+    job.timer.async_wait([this, &job](const boost::system::error_code &ec)
+                         {
+                             if (ec || m_stopped)
+                             {
+                                 return;
+                             }
+                             m_ready.push_back(&job);
+                             launchReady(); });
+}
+
+void FetchScheduler::launchReady()
+{
+    while (!m_stopped && m_inFlight < m_pool.options().maxConcurrent && !m_ready.empty())
+    {
+        Job &job = *m_ready.front();
+        m_ready.pop_front();
+
+        ++m_inFlight;
+        job.lastStart = std::chrono::steady_clock::now();
+        job.request = std::make_shared<UpstreamRequest>(m_pool, job.target);
+        if (m_makeSink)
+        {
+            job.request->setBodySink(m_makeSink(job.name));
+        }
+        if (m_pool.options().conditionalRequests)
+        {
+            job.request->setValidators(job.etag, job.lastModified);
+        }
+        job.request->start([this, &job](UpstreamResult result)
+                           { onFetched(job, std::move(result)); });
+    }
+}
+
+void FetchScheduler::onFetched(Job &job, UpstreamResult result)
+{
+    --m_inFlight;
+    job.request.reset();
+    if (m_stopped)
+    {
+        return;
+    }
+
+    // Validators are only sent once there was a 200, so a 304 always has a body to stand for
+    result.unchanged = result.notModified && job.haveBody;
+    if (result.ok)
+    {
+        result.unchanged = job.haveBody && job.bodyHash == result.bodyHash;
+        job.bodyHash = result.bodyHash;
+        job.haveBody = true;
+        job.etag = std::move(result.etag);
+        job.lastModified = std::move(result.lastModified);
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - job.lastStart);
+        FLASHFEED_LOG_INFO("Successfully fetched market data for {} in {} us", job.name, elapsed.count());
+    }
+    if (result.unchanged)
+    {
+        ++m_pool.stats().unchanged;
+        FLASHFEED_LOG_INFO("Market data for {} {} since the last fetch", job.name, result.notModified ? "not modified" : "unchanged");
+    }
+    // Roughly once per round of jobs
+    if (m_pool.stats().requests % m_jobs.size() == 0)
+    {
+        FLASHFEED_LOG_INFO("Upstream {}: {}", m_pool.host(), m_pool.stats().summary());
+    }
+
+    bool kept = false;
+    try
+    {
+        kept = m_onResult(job.name, std::move(result));
+    }
+    catch (const std::exception &e)
+    {
+        FLASHFEED_LOG_ERROR("Error handling fetch result for {}: {}", job.name, e.what());
+    }
+    if (!kept)
+    {
+        // Whatever replaced the job's data instead, the next response must be taken in full
+        job.haveBody = false;
+        job.bodyHash = 0;
+        job.etag.clear();
+        job.lastModified.clear();
+    }
+
+    job.timer.expires_at(job.lastStart + job.interval);
+    waitForDue(job);
+    launchReady();
+}
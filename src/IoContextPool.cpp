@@ -0,0 +1,82 @@
+#include "IoContextPool.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+
+IoContextPool::IoContextPool(std::size_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_contexts.reserve(threadCount);
+    m_workGuards.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i)
+    {
+        // Concurrency hint 1: each context is only ever run by its own thread
+        m_contexts.push_back(std::make_unique<boost::asio::io_context>(1));
+        m_workGuards.push_back(boost::asio::make_work_guard(*m_contexts.back()));
+    }
+}
+
+IoContextPool::~IoContextPool()
+{
+    stop();
+    join();
+}
+
+void IoContextPool::run()
+{
+    if (!m_threads.empty())
+    {
+        return;
+    }
+
+    m_threads.reserve(m_contexts.size());
+    for (auto &context : m_contexts)
+    {
+        m_threads.emplace_back([&context]()
+                               {
+            // A handler that throws would otherwise end the thread and strand its sessions
+            while (!context->stopped())
+            {
+                try
+                {
+                    context->run();
+                }
+                catch (const std::exception &e)
+                {
+                    FLASHFEED_LOG_ERROR("Unhandled exception in IO thread: {}", e.what());
+                }
+            } });
+    }
+}
+
+void IoContextPool::stop()
+{
+    for (auto &guard : m_workGuards)
+    {
+        guard.reset();
+    }
+    for (auto &context : m_contexts)
+    {
+        context->stop();
+    }
+}
+
+void IoContextPool::join()
+{
+    for (auto &thread : m_threads)
+    {
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+    m_threads.clear();
+}
+
+boost::asio::io_context &IoContextPool::next()
+{
+    return *m_contexts[m_next.fetch_add(1, std::memory_order_relaxed) % m_contexts.size()];
+}
@@ -0,0 +1,434 @@
+#include "JsonBarParser.hpp"
+#include <algorithm>
+#include <charconv>
+
+namespace
+{
+    constexpr int TIMESTAMP_FIELD = 0;
+    // Fields 1..5 in bit order after the timestamp
+    double MarketDataEntry::*const PRICE_FIELDS[] = {
+        &MarketDataEntry::m_open, &MarketDataEntry::m_high, &MarketDataEntry::m_low,
+        &MarketDataEntry::m_close, &MarketDataEntry::m_volume};
+
+    bool isWhitespace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    // Characters of numbers and of true/false/null
+    bool isBareChar(char c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+    }
+
+    bool isValidBare(std::string_view text)
+    {
+        if (text == "true" || text == "false" || text == "null")
+        {
+            return true;
+        }
+        double value;
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && ptr == text.data() + text.size();
+    }
+
+    // "1. open" and "open" both name the open field; -1 for anything else
+    int fieldIndex(std::string_view key)
+    {
+        std::size_t digits = 0;
+        while (digits < key.size() && key[digits] >= '0' && key[digits] <= '9')
+        {
+            ++digits;
+        }
+        if (digits > 0 && key.substr(digits, 2) == ". ")
+        {
+            key.remove_prefix(digits + 2);
+        }
+
+        static constexpr std::string_view NAMES[] = {"timestamp", "open", "high", "low", "close", "volume"};
+        for (int i = 0; i < 6; ++i)
+        {
+            if (key == NAMES[i])
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+}
+
+JsonBarParser::JsonBarParser(std::vector<MarketDataEntry> &out)
+    : m_out(out)
+{
+}
+
+bool JsonBarParser::feed(std::string_view chunk)
+{
+    const char *p = chunk.data();
+    const char *const end = p + chunk.size();
+
+    while (p < end)
+    {
+        switch (m_state)
+        {
+        case State::String:
+        {
+            const char *start = p;
+            for (; p < end; ++p)
+            {
+                if (m_escaped)
+                {
+                    m_escaped = false;
+                }
+                else if (*p == '\\')
+                {
+                    m_escaped = true;
+                }
+                else if (*p == '"')
+                {
+                    break;
+                }
+                else if (static_cast<unsigned char>(*p) < 0x20)
+                {
+                    return fail();
+                }
+            }
+            if (p == end)
+            {
+                if (m_capture)
+                {
+                    m_carry.append(start, p);
+                    m_carrying = true;
+                }
+                return true;
+            }
+
+            std::string_view text(start, static_cast<std::size_t>(p - start));
+            if (m_carrying)
+            {
+                m_carry.append(start, p);
+                text = m_carry;
+            }
+            ++p; // Closing quote
+            if (m_stringIsKey)
+            {
+                if (m_capture)
+                {
+                    onKey(text);
+                }
+                m_state = State::Colon;
+            }
+            else
+            {
+                if (m_capture)
+                {
+                    onScalar(text);
+                }
+                m_state = State::AfterValue;
+            }
+            m_carry.clear();
+            m_carrying = false;
+            continue;
+        }
+
+        case State::Bare:
+        {
+            const char *start = p;
+            while (p < end && isBareChar(*p))
+            {
+                ++p;
+            }
+            if (p == end)
+            {
+                m_carry.append(start, p);
+                m_carrying = true;
+                return true;
+            }
+
+            std::string_view text(start, static_cast<std::size_t>(p - start));
+            if (m_carrying)
+            {
+                m_carry.append(start, p);
+                text = m_carry;
+            }
+            if (!isValidBare(text))
+            {
+                return fail();
+            }
+            if (m_capture)
+            {
+                onScalar(text);
+            }
+            m_carry.clear();
+            m_carrying = false;
+            m_state = State::AfterValue; // The delimiter is handled there
+            continue;
+        }
+
+        case State::Error:
+            return false;
+
+        default:
+            break;
+        }
+
+        const char c = *p++;
+        if (isWhitespace(c))
+        {
+            continue;
+        }
+
+        switch (m_state)
+        {
+        case State::FirstValue:
+            if (c == ']')
+            {
+                if (!closeContainer(false))
+                {
+                    return false;
+                }
+                break;
+            }
+            [[fallthrough]];
+        case State::Value:
+            if (c == '{' || c == '[')
+            {
+                if (!openContainer(c == '{'))
+                {
+                    return false;
+                }
+                m_state = c == '{' ? State::FirstKey : State::FirstValue;
+            }
+            else if (m_depth == 0)
+            {
+                return fail(); // The document must be an object or an array
+            }
+            else if (c == '"')
+            {
+                const Role role = currentRole();
+                m_stringIsKey = false;
+                m_capture = (role == Role::Bar && m_field >= 0) || (role == Role::RootObject && m_valueRole == Role::Message);
+                m_state = State::String;
+            }
+            else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n')
+            {
+                m_capture = currentRole() == Role::Bar && m_field >= 0;
+                m_state = State::Bare;
+                --p; // Part of the token
+            }
+            else
+            {
+                return fail();
+            }
+            break;
+
+        case State::FirstKey:
+            if (c == '}')
+            {
+                if (!closeContainer(true))
+                {
+                    return false;
+                }
+                break;
+            }
+            [[fallthrough]];
+        case State::Key:
+            if (c != '"')
+            {
+                return fail();
+            }
+            m_stringIsKey = true;
+            m_capture = currentRole() != Role::Skip;
+            m_state = State::String;
+            break;
+
+        case State::Colon:
+            if (c != ':')
+            {
+                return fail();
+            }
+            m_state = State::Value;
+            break;
+
+        case State::AfterValue:
+            if (c == ',')
+            {
+                m_state = m_stack[m_depth - 1].isObject ? State::Key : State::Value;
+            }
+            else if (c == '}' || c == ']')
+            {
+                if (!closeContainer(c == '}'))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return fail();
+            }
+            break;
+
+        case State::Done:
+            return fail(); // Trailing content after the document
+
+        default:
+            return fail();
+        }
+    }
+    return true;
+}
+
+bool JsonBarParser::finish()
+{
+    return m_state == State::Done;
+}
+
+void JsonBarParser::sortByTimestamp(std::vector<MarketDataEntry> &bars)
+{
+    auto earlier = [](const MarketDataEntry &a, const MarketDataEntry &b)
+    { return a.m_timestamp < b.m_timestamp; };
+    if (std::is_sorted(bars.begin(), bars.end(), earlier))
+    {
+        return;
+    }
+    if (std::is_sorted(bars.rbegin(), bars.rend(), earlier))
+    {
+        std::reverse(bars.begin(), bars.end());
+        return;
+    }
+    std::sort(bars.begin(), bars.end(), earlier);
+}
+
+bool JsonBarParser::fail()
+{
+    m_state = State::Error;
+    return false;
+}
+
+bool JsonBarParser::openContainer(bool isObject)
+{
+    if (m_depth == MAX_DEPTH)
+    {
+        return fail();
+    }
+
+    Role role = Role::Skip;
+    switch (currentRole())
+    {
+    case Role::RootObject:
+        role = isObject && m_valueRole == Role::Series ? Role::Series : Role::Skip;
+        break;
+    case Role::Series:
+    case Role::RootArray:
+        role = isObject ? Role::Bar : Role::Skip;
+        break;
+    default:
+        break;
+    }
+    if (m_depth == 0)
+    {
+        role = isObject ? Role::RootObject : Role::RootArray;
+    }
+
+    if (role == Role::Bar)
+    {
+        // Series bars are keyed by their timestamp; array bars carry it as a field
+        const bool keyed = currentRole() == Role::Series && m_seriesTimestampValid;
+        m_bar = MarketDataEntry{};
+        m_bar.m_timestamp = keyed ? m_seriesTimestamp : Timestamp();
+        m_barFields = keyed ? 1 : 0;
+        m_field = -1;
+    }
+
+    m_stack[m_depth++] = Frame{role, isObject};
+    return true;
+}
+
+bool JsonBarParser::closeContainer(bool isObject)
+{
+    if (m_depth == 0 || m_stack[m_depth - 1].isObject != isObject)
+    {
+        return fail();
+    }
+    if (m_stack[--m_depth].role == Role::Bar)
+    {
+        finishBar();
+    }
+    m_state = m_depth == 0 ? State::Done : State::AfterValue;
+    return true;
+}
+
+void JsonBarParser::finishBar()
+{
+    if (m_barFields == ALL_FIELDS)
+    {
+        m_out.push_back(m_bar);
+    }
+    else
+    {
+        ++m_skippedBars;
+    }
+}
+
+void JsonBarParser::onKey(std::string_view key)
+{
+    switch (currentRole())
+    {
+    case Role::RootObject:
+        if (key.substr(0, 11) == "Time Series")
+        {
+            m_valueRole = Role::Series;
+        }
+        else if (key == "Information" || key == "Note" || key == "Error Message")
+        {
+            m_valueRole = Role::Message;
+        }
+        else
+        {
+            m_valueRole = Role::Skip;
+        }
+        break;
+    case Role::Series:
+        m_seriesTimestampValid = Timestamp::parse(key, m_seriesTimestamp);
+        break;
+    case Role::Bar:
+        m_field = fieldIndex(key);
+        break;
+    default:
+        break;
+    }
+}
+
+void JsonBarParser::onScalar(std::string_view text)
+{
+    const Role role = currentRole();
+    if (role == Role::RootObject)
+    {
+        m_apiMessage.assign(text.data(), text.size());
+        return;
+    }
+    if (role != Role::Bar || m_field < 0)
+    {
+        return;
+    }
+
+    bool parsed;
+    if (m_field == TIMESTAMP_FIELD)
+    {
+        parsed = Timestamp::parse(text, m_bar.m_timestamp);
+    }
+    else
+    {
+        double &value = m_bar.*PRICE_FIELDS[m_field - 1];
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        parsed = ec == std::errc() && ptr == text.data() + text.size() && ptr != text.data();
+    }
+    if (parsed)
+    {
+        m_barFields |= static_cast<std::uint8_t>(1u << m_field);
+    }
+    else
+    {
+        m_barFields &= static_cast<std::uint8_t>(~(1u << m_field));
+    }
+}
@@ -0,0 +1,188 @@
+#include "LatencyHistogram.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    unsigned highestBit(std::uint64_t value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+        unsigned bit = 0;
+        while (value >>= 1)
+        {
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+
+    double toMicros(std::uint64_t nanos)
+    {
+        return static_cast<double>(nanos) / 1000.0;
+    }
+}
+
+std::size_t LatencyHistogram::bucketFor(std::uint64_t nanos)
+{
+    if (nanos < SUB_BUCKET_COUNT)
+    {
+        return static_cast<std::size_t>(nanos);
+    }
+    nanos = std::min(nanos, MAX_TRACKED);
+    // The top SUB_BUCKET_BITS + 1 bits pick the bucket within the value's power of two
+    const unsigned magnitude = highestBit(nanos);
+    const unsigned shift = magnitude - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKET_COUNT + static_cast<std::size_t>(nanos >> shift) - SUB_BUCKET_COUNT;
+}
+
+std::uint64_t LatencyHistogram::highestEquivalent(std::size_t bucket)
+{
+    const std::size_t group = bucket / SUB_BUCKET_COUNT;
+    const std::uint64_t sub = bucket % SUB_BUCKET_COUNT;
+    if (group == 0)
+    {
+        return sub;
+    }
+    const unsigned shift = static_cast<unsigned>(group - 1);
+    return ((sub + SUB_BUCKET_COUNT) << shift) + ((std::uint64_t(1) << shift) - 1);
+}
+
+LatencySnapshot::LatencySnapshot()
+    : m_counts(LatencyHistogram::BUCKET_COUNT, 0)
+{
+}
+
+void LatencySnapshot::add(const LatencyHistogram &histogram)
+{
+    for (std::size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i)
+    {
+        m_counts[i] += histogram.m_counts[i].load(std::memory_order_relaxed);
+    }
+    m_count += histogram.m_count.load(std::memory_order_relaxed);
+    m_sum += histogram.m_sum.load(std::memory_order_relaxed);
+    m_max = std::max(m_max, histogram.m_max.load(std::memory_order_relaxed));
+}
+
+void LatencySnapshot::subtract(const LatencySnapshot &earlier)
+{
+    std::size_t highest = 0;
+    bool any = false;
+    for (std::size_t i = 0; i < m_counts.size(); ++i)
+    {
+        // Counters only grow, but they are read one at a time while being written
+        m_counts[i] -= std::min(m_counts[i], earlier.m_counts[i]);
+        if (m_counts[i] > 0)
+        {
+            highest = i;
+            any = true;
+        }
+    }
+    m_count -= std::min(m_count, earlier.m_count);
+    m_sum -= std::min(m_sum, earlier.m_sum);
+    m_max = any ? std::min(m_max, LatencyHistogram::highestEquivalent(highest)) : 0;
+}
+
+double LatencySnapshot::mean() const
+{
+    return m_count ? static_cast<double>(m_sum) / static_cast<double>(m_count) : 0.0;
+}
+
+std::uint64_t LatencySnapshot::percentile(double percent) const
+{
+    // Counts are read bucket by bucket, so their total can differ slightly from m_count
+    std::uint64_t total = 0;
+    for (std::uint64_t count : m_counts)
+    {
+        total += count;
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+    const double clamped = std::clamp(percent, 0.0, 100.0);
+    const std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(total))));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < m_counts.size(); ++i)
+    {
+        seen += m_counts[i];
+        if (seen >= rank)
+        {
+            return std::min(LatencyHistogram::highestEquivalent(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+std::string LatencySnapshot::summary() const
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << "n=" << m_count << ", p50=" << toMicros(percentile(50))
+        << " us, p99=" << toMicros(percentile(99)) << " us, p99.9=" << toMicros(percentile(99.9))
+        << " us, max=" << toMicros(m_max) << " us";
+    return out.str();
+}
+
+const char *latencyStageName(LatencyStage stage)
+{
+    switch (stage)
+    {
+    case LatencyStage::Fetch:
+        return "fetch";
+    case LatencyStage::Parse:
+        return "parse";
+    case LatencyStage::CacheUpdate:
+        return "cache_update";
+    case LatencyStage::Serialize:
+        return "serialize";
+    case LatencyStage::Enqueue:
+        return "enqueue";
+    case LatencyStage::WriteComplete:
+        return "write_complete";
+    case LatencyStage::TickToWrite:
+        return "tick_to_write";
+    }
+    return "unknown";
+}
+
+LatencyRecorder &LatencyRecorder::getInstance()
+{
+    static LatencyRecorder instance;
+    return instance;
+}
+
+std::int64_t LatencyRecorder::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+LatencyRecorder::Shard &LatencyRecorder::localShard()
+{
+    thread_local Shard *shard = nullptr;
+    if (!shard)
+    {
+        auto created = std::make_unique<Shard>();
+        shard = created.get();
+        std::lock_guard<std::mutex> lock(m_shardsMutex);
+        m_shards.push_back(std::move(created));
+    }
+    return *shard;
+}
+
+LatencyRecorder::Snapshots LatencyRecorder::snapshot() const
+{
+    Snapshots snapshots;
+    std::lock_guard<std::mutex> lock(m_shardsMutex);
+    for (const auto &shard : m_shards)
+    {
+        for (std::size_t stage = 0; stage < LATENCY_STAGE_COUNT; ++stage)
+        {
+            snapshots[stage].add(shard->stages[stage]);
+        }
+    }
+    return snapshots;
+}
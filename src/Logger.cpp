@@ -1,48 +1,294 @@
 #include "Logger.hpp"
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <stdexcept>
 
+namespace
+{
+    constexpr std::uint64_t RING_MASK = Logger::CAPACITY - 1;
+    static_assert((Logger::CAPACITY & RING_MASK) == 0, "Ring capacity must be a power of two");
+
+    // An idle writer looks for new messages this often. Producers only wake it early
+    // for an ERROR or once the ring is half full, so a log call rarely makes a syscall.
+    constexpr auto WRITER_IDLE_WAIT = std::chrono::milliseconds(5);
+    constexpr std::uint64_t WAKE_THRESHOLD = Logger::CAPACITY / 2;
+
+    const char *levelTag(Logger::LogLevel level)
+    {
+        switch (level)
+        {
+        case Logger::LogLevel::INFO:
+            return "[INFO]";
+        case Logger::LogLevel::WARNING:
+            return "[WARNING]";
+        case Logger::LogLevel::ERROR:
+            return "[ERROR]";
+        }
+        return "";
+    }
+
+    // "YYYY-MM-DD HH:MM:SS.uuuuuu " in local time. The date and time part is
+    // only recomputed when the second changes.
+    class TimestampFormatter
+    {
+    public:
+        void append(std::string &out, std::int64_t timeNs)
+        {
+            const std::int64_t seconds = timeNs / 1000000000;
+            if (seconds != m_second)
+            {
+                std::time_t time = static_cast<std::time_t>(seconds);
+                std::tm local{};
+#ifdef _WIN32
+                localtime_s(&local, &time);
+#else
+                localtime_r(&time, &local);
+#endif
+                m_secondLength = std::strftime(m_secondText, sizeof(m_secondText), "%Y-%m-%d %H:%M:%S", &local);
+                m_second = seconds;
+            }
+            char micros[16];
+            const int length = std::snprintf(micros, sizeof(micros), ".%06d ", static_cast<int>(timeNs % 1000000000 / 1000));
+            out.append(m_secondText, m_secondLength);
+            out.append(micros, static_cast<std::size_t>(length));
+        }
+
+    private:
+        std::int64_t m_second = -1;
+        char m_secondText[32] = {};
+        std::size_t m_secondLength = 0;
+    };
+
+    // Constant-initialized, so usable however early the logger is first used
+    TimestampFormatter g_writerTimestamps; // Only the writer thread formats
+}
+
+Logger::Logger()
+    : m_ring(std::make_unique<Record[]>(CAPACITY))
+{
+    for (std::uint64_t i = 0; i < CAPACITY; ++i)
+    {
+        m_ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    m_writer = std::thread(&Logger::writerLoop, this);
+}
 
 Logger::~Logger()
 {
+    m_stopping = true;
+    wakeWriter();
+    if (m_writer.joinable())
+    {
+        m_writer.join();
+    }
     if (m_logStream.is_open())
     {
         m_logStream.close();
     }
-    
+
+}
+
+void Logger::enqueue(std::string &&message, LogLevel level)
+{
+    std::uint64_t position;
+    if (Record *record = claim(level, position))
+    {
+        record->message = std::move(message);
+        publish(*record, position, level);
+    }
 }
 
-void Logger::log(const std::string& message, LogLevel level)
+void Logger::enqueue(std::unique_ptr<LogFormat::Message> message, LogLevel level)
+{
+    std::uint64_t position;
+    if (Record *record = claim(level, position))
     {
-        std::lock_guard<std::mutex> lock(logMutex); // Thread Safety
+        record->deferred = std::move(message);
+        publish(*record, position, level);
+    }
+}
 
-        // Checks if log file if not, then lets put on the cerr output stream
-        std::ostream& stream = m_logStream.is_open() ? m_logStream : std::cerr;
-        
-        switch (level)
+Logger::Record *Logger::claim(LogLevel level, std::uint64_t &position)
+{
+    bool stalled = false;
+    position = m_tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Record *record = &m_ring[position & RING_MASK];
+        const std::uint64_t sequence = record->sequence.load(std::memory_order_acquire);
+        const std::int64_t difference = static_cast<std::int64_t>(sequence - position);
+        if (difference == 0)
+        {
+            // The slot is free for this lap; claim it
+            if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                return record;
+            }
+        }
+        else if (difference < 0)
+        {
+            // Full: the writer has not yet freed the slot from the previous lap
+            if (level != LogLevel::ERROR)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            if (!stalled)
+            {
+                stalled = true;
+                m_stalls.fetch_add(1, std::memory_order_relaxed);
+            }
+            wakeWriter();
+            std::this_thread::yield();
+            position = m_tail.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            // Another producer claimed it first
+            position = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::publish(Record &record, std::uint64_t position, LogLevel level)
+{
+    record.level = level;
+    record.timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count();
+    record.sequence.store(position + 1, std::memory_order_release);
+
+    if (level == LogLevel::ERROR || position - m_consumed.load(std::memory_order_relaxed) >= WAKE_THRESHOLD)
+    {
+        // Pairs with the fence in writerLoop, so either the writer sees this record before it
+        // sleeps or this thread sees it sleeping
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_writerSleeping.load(std::memory_order_relaxed))
+        {
+            wakeWriter();
+        }
+    }
+}
+
+void Logger::wakeWriter()
+{
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_wake.notify_all();
+}
+
+std::size_t Logger::drain(std::string &batch)
+{
+    std::size_t count = 0;
+    for (;;)
+    {
+        Record &record = m_ring[m_head & RING_MASK];
+        if (record.sequence.load(std::memory_order_acquire) != m_head + 1)
         {
-        case LogLevel::INFO :
-            stream << "[INFO]";
-            break;
-        case LogLevel::WARNING :
-            stream << "[WARNING]";
-            break;
-        case LogLevel::ERROR:
-            stream << "[ERROR]";
             break;
         }
-        stream << message << std::endl;
+        g_writerTimestamps.append(batch, record.timeNs);
+        batch += levelTag(record.level);
+        if (record.deferred)
+        {
+            record.deferred->formatTo(batch);
+            record.deferred.reset();
+        }
+        else
+        {
+            batch += record.message;
+            record.message.clear();
+        }
+        batch += '\n';
+        record.sequence.store(m_head + CAPACITY, std::memory_order_release);
+        ++m_head;
+        ++count;
     }
+    return count;
+}
 
-    void Logger::setLogFile(const std::string& logFile)
+void Logger::writerLoop()
+{
+    std::string batch;
+    std::uint64_t reportedDrops = 0;
+    for (;;)
     {
-        std::lock_guard<std::mutex> lock(logMutex); // Thread Safety
-        if (m_logStream.is_open())
+        batch.clear();
+        const std::size_t count = drain(batch);
+
+        const std::uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+        if (dropped != reportedDrops)
+        {
+            g_writerTimestamps.append(batch, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                 std::chrono::system_clock::now().time_since_epoch())
+                                                 .count());
+            batch += "[WARNING]Log queue full: dropped " + std::to_string(dropped - reportedDrops) + " messages\n";
+            reportedDrops = dropped;
+        }
+
+        if (!batch.empty())
+        {
+            std::lock_guard<std::mutex> lock(m_outputMutex);
+            // Checks if log file if not, then lets put on the cerr output stream
+            std::ostream &stream = m_logStream.is_open() ? m_logStream : std::cerr;
+            stream.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+            stream.flush();
+        }
+        if (count > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_consumed.store(m_head, std::memory_order_release);
+            m_flushed.notify_all();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        if (m_stopping)
         {
-            m_logStream.close();
-        }        
-        m_logStream.open(logFile,std::ios::app);
-        if(!m_logStream.is_open())
+            break;
+        }
+        m_writerSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_ring[m_head & RING_MASK].sequence.load(std::memory_order_acquire) != m_head + 1)
         {
-            throw std::runtime_error("Error: Unable to open log file" + logFile);
+            m_wake.wait_for(lock, WRITER_IDLE_WAIT);
         }
+        m_writerSleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+void Logger::flush()
+{
+    const std::uint64_t target = m_tail.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wake.notify_all();
+    m_flushed.wait(lock, [this, target]
+                   { return m_consumed.load(std::memory_order_acquire) >= target; });
+}
 
-    }
\ No newline at end of file
+void Logger::setLogFile(const std::string& logFile)
+{
+    // Earlier messages keep going where they were logged to
+    flush();
+    std::lock_guard<std::mutex> lock(m_outputMutex); // Thread Safety
+    if (m_logStream.is_open())
+    {
+        m_logStream.close();
+    }
+    m_logStream.open(logFile,std::ios::app);
+    if(!m_logStream.is_open())
+    {
+        throw std::runtime_error("Error: Unable to open log file" + logFile);
+    }
+
+}
+
+Logger::Stats Logger::stats() const
+{
+    Stats stats;
+    stats.logged = m_tail.load(std::memory_order_relaxed);
+    stats.written = m_consumed.load(std::memory_order_relaxed);
+    stats.dropped = m_dropped.load(std::memory_order_relaxed);
+    stats.stalls = m_stalls.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -43,7 +43,7 @@ std::filesystem::path get_executable_dir()
         return std::filesystem::path(actualpath).parent_path();
     }
 #endif
-    Logger::getInstance().log("Warning: Could not reliably determine executable directory. Falling back to current working directory.", Logger::LogLevel::WARNING);
+    FLASHFEED_LOG_WARNING("Warning: Could not reliably determine executable directory. Falling back to current working directory.");
     return std::filesystem::current_path();
 }
 
@@ -82,35 +82,69 @@ int main(int argc, char *argv[])
     {
         appConfig = ConfigLoader::loadConfig(configFilePath.string());
         Logger::getInstance().setLogFile(appConfig.logFilePath);
-        Logger::getInstance().log("Server application starting with config: " + configFilePath.string(), Logger::LogLevel::INFO);
+        FLASHFEED_LOG_INFO("Server application starting with config: {}", configFilePath.string());
     }
     catch (const std::exception &e)
     {
         std::cerr << "SERVER FATAL ERROR loading configuration '" << configFilePath.string() << "': " << e.what() << std::endl;
-        Logger::getInstance().log("SERVER FATAL ERROR loading configuration '" + configFilePath.string() + "': " + e.what(), Logger::LogLevel::ERROR);
+        FLASHFEED_LOG_ERROR("SERVER FATAL ERROR loading configuration '{}': {}", configFilePath.string(), e.what());
         return 1;
     }
 
     // --- Run as Server ---
-    Logger::getInstance().log("Running in Server mode.", Logger::LogLevel::INFO);
+    FLASHFEED_LOG_INFO("Running in Server mode.");
     std::cout << "Starting Market Data Server..." << std::endl;
 
     MarketDataServer::ServerConfig &config = appConfig.serverConfig;
+    for (int i = 1; i < argc; ++i) // --replay <speed> overrides the config's replay settings
+    {
+        if (std::string(argv[i]) == "--replay" && i + 1 < argc)
+        {
+            try
+            {
+                config.replay.speed = std::stod(argv[i + 1]);
+                config.replay.enabled = config.replay.speed >= 0;
+            }
+            catch (const std::exception &)
+            {
+                std::cerr << "Ignoring invalid replay speed '" << argv[i + 1] << "'" << std::endl;
+            }
+            break;
+        }
+    }
+
     MarketDataServer::SubscriptionManager subscriptionManager;
-    std::thread fetchThread = MarketDataServer::StartPeriodicFetching(config, subscriptionManager);
+    std::thread fetchThread;
+    if (config.replay.enabled)
+    {
+        // Replay publishes the CSV history from an empty cache instead of fetching
+        fetchThread = MarketDataServer::StartReplay(config, subscriptionManager);
+    }
+    else
+    {
+        MarketDataServer::RestoreSnapshots(config); // Last known data is served until the first fetch completes
+        fetchThread = MarketDataServer::StartPeriodicFetching(config, subscriptionManager);
+    }
 
     MarketDataServer::StartServer(config, subscriptionManager); // This will block until server stops
 
     // --- Cleanup ---
-    Logger::getInstance().log("Server has stopped listening. Cleaning up...", Logger::LogLevel::INFO);
-    MarketDataServer::StopPeriodicFetching(); // Signal the fetching thread to stop
+    FLASHFEED_LOG_INFO("Server has stopped listening. Cleaning up...");
+    if (config.replay.enabled)
+    {
+        MarketDataServer::StopReplay();
+    }
+    else
+    {
+        MarketDataServer::StopPeriodicFetching(); // Signal the fetching thread to stop
+    }
     if (fetchThread.joinable())
     {
-        Logger::getInstance().log("Waiting for data fetching thread to join...", Logger::LogLevel::INFO);
+        FLASHFEED_LOG_INFO("Waiting for data fetching thread to join...");
         fetchThread.join(); // Wait for the thread to complete its current cycle and exit
-        Logger::getInstance().log("Data fetching thread joined.", Logger::LogLevel::INFO);
+        FLASHFEED_LOG_INFO("Data fetching thread joined.");
     }
-    Logger::getInstance().log("Server shutdown complete.", Logger::LogLevel::INFO);
-    Logger::getInstance().log("Server application exiting normally.", Logger::LogLevel::INFO);
+    FLASHFEED_LOG_INFO("Server shutdown complete.");
+    FLASHFEED_LOG_INFO("Server application exiting normally.");
     return 0;
 }
\ No newline at end of file
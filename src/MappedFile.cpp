@@ -0,0 +1,146 @@
+#include "MappedFile.hpp"
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FLASHFEED_HAS_MMAP 1
+#endif
+
+MappedFile::MappedFile(const std::string &path, Mode mode)
+{
+    open(path, mode);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        m_isOpen = std::exchange(other.m_isOpen, false);
+        m_isMapped = std::exchange(other.m_isMapped, false);
+        m_size = std::exchange(other.m_size, 0);
+        m_buffer = std::move(other.m_buffer);
+        // The owned buffer moved with its storage, so re-point at it
+        const char *otherData = std::exchange(other.m_data, nullptr);
+        m_data = m_isMapped ? otherData : m_buffer.data();
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string &path, Mode mode)
+{
+    close();
+
+#ifdef FLASHFEED_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    if (mode == Mode::Copy)
+    {
+        // Read to end of file rather than to the size stat gave, which an edit may already have changed
+        m_buffer.reserve(static_cast<std::size_t>(st.st_size));
+        char chunk[65536];
+        for (;;)
+        {
+            const ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n < 0)
+            {
+                ::close(fd);
+                m_buffer.clear();
+                return false;
+            }
+            if (n == 0)
+            {
+                break;
+            }
+            m_buffer.append(chunk, static_cast<std::size_t>(n));
+        }
+        ::close(fd);
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+        m_isOpen = true;
+        return true;
+    }
+
+    m_size = static_cast<std::size_t>(st.st_size);
+    if (m_size == 0)
+    {
+        // mmap rejects zero-length mappings; an empty file is still a valid open
+        ::close(fd);
+        m_data = m_buffer.data();
+        m_isOpen = true;
+        return true;
+    }
+
+    void *addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps its own reference to the file
+    if (addr == MAP_FAILED)
+    {
+        m_size = 0;
+        return false;
+    }
+    ::madvise(addr, m_size, MADV_SEQUENTIAL);
+
+    m_data = static_cast<const char *>(addr);
+    m_isMapped = true;
+    m_isOpen = true;
+    return true;
+#else
+    (void)mode; // Always an owned copy
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    m_buffer.assign(std::istreambuf_iterator<char>(file), {});
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    m_isOpen = true;
+    return true;
+#endif
+}
+
+void MappedFile::close()
+{
+#ifdef FLASHFEED_HAS_MMAP
+    if (m_isMapped)
+    {
+        ::munmap(const_cast<char *>(m_data), m_size);
+    }
+#endif
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+    m_isMapped = false;
+}
@@ -0,0 +1,206 @@
+#include "ReplayEngine.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <queue>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+namespace
+{
+    // Waits shorter than this are spun out instead of slept, since a sleeping
+    // thread typically wakes 50-100 us after it asked to
+    constexpr auto SPIN_MARGIN = std::chrono::microseconds(200);
+
+    std::chrono::nanoseconds percentile(std::vector<std::int64_t> samples, double p)
+    {
+        if (samples.empty())
+        {
+            return std::chrono::nanoseconds(0);
+        }
+        auto nth = samples.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(samples.size() - 1));
+        std::nth_element(samples.begin(), nth, samples.end());
+        return std::chrono::nanoseconds(*nth);
+    }
+
+    std::string formatMicros(std::chrono::nanoseconds value)
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << static_cast<double>(value.count()) / 1000.0 << " us";
+        return out.str();
+    }
+}
+
+double ReplayStats::barsPerSecond() const
+{
+    return elapsed.count() > 0 ? static_cast<double>(bars) * 1e9 / static_cast<double>(elapsed.count()) : 0.0;
+}
+
+std::string ReplayStats::summary() const
+{
+    std::ostringstream out;
+    out << bars << " bars in " << std::fixed << std::setprecision(3)
+        << std::chrono::duration<double>(elapsed).count() << " s, "
+        << std::setprecision(0) << barsPerSecond() << " bars/s";
+    if (paced)
+    {
+        out << ", lateness p50 " << formatMicros(latenessP50) << " / p99 " << formatMicros(latenessP99)
+            << " / max " << formatMicros(latenessMax);
+    }
+    return out.str();
+}
+
+ReplayEngine::ReplayEngine(ReplayOptions options, Publisher publish)
+    : m_options(std::move(options)), m_publish(std::move(publish))
+{
+}
+
+std::size_t ReplayEngine::addStream(std::vector<MarketDataEntry> bars)
+{
+    m_streams.push_back(std::move(bars));
+    return m_streams.size() - 1;
+}
+
+void ReplayEngine::run()
+{
+    // Min-heap of (next timestamp, stream); the stream index breaks ties so the order is deterministic
+    using Cursor = std::pair<Timestamp, std::size_t>;
+    std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor>> heap;
+    std::vector<std::size_t> next(m_streams.size(), 0);
+    std::size_t total = 0;
+    for (std::size_t stream = 0; stream < m_streams.size(); ++stream)
+    {
+        total += m_streams[stream].size();
+        if (!m_streams[stream].empty())
+        {
+            heap.emplace(m_streams[stream].front().m_timestamp, stream);
+        }
+    }
+    if (heap.empty())
+    {
+        return;
+    }
+
+    if (m_options.speed > 0)
+    {
+        FLASHFEED_LOG_INFO("Replaying {} bars from {} symbols at {}x, starting in {} s", total, m_streams.size(), m_options.speed,
+                           m_options.startDelay.count());
+    }
+    else
+    {
+        FLASHFEED_LOG_INFO("Replaying {} bars from {} symbols at full speed, starting in {} s", total, m_streams.size(),
+                           m_options.startDelay.count());
+    }
+    if (!waitUntil(Clock::now() + m_options.startDelay))
+    {
+        return;
+    }
+
+    const bool paced = m_options.speed > 0;
+    const Timestamp first = heap.top().first;
+    m_latenessNs.reserve(total);
+    m_started = Clock::now();
+    Clock::time_point nextReport = m_started + m_options.reportInterval;
+    std::vector<MarketDataEntry> batch; // Reused for every stream and tick
+
+    while (!heap.empty() && !m_stopped)
+    {
+        // The earliest pending bar starts the tick; its deadline is waited for and measured
+        Timestamp releaseUntil = heap.top().first;
+        if (paced)
+        {
+            const double offsetNs = static_cast<double>(releaseUntil.m_nanos - first.m_nanos) / m_options.speed;
+            const Clock::time_point deadline = m_started + std::chrono::nanoseconds(static_cast<std::int64_t>(offsetNs));
+            if (!waitUntil(deadline))
+            {
+                break;
+            }
+            const Clock::time_point now = Clock::now();
+            m_latenessNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline).count());
+
+            // Bars that fell due while the last tick was being published go out with this one
+            const double replayedNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_started).count()) *
+                                      m_options.speed;
+            releaseUntil = std::max(releaseUntil, Timestamp(first.m_nanos + static_cast<std::int64_t>(replayedNs)));
+        }
+
+        // Streams in the order of their first due bar, each stream's due bars in one call
+        while (!heap.empty() && heap.top().first <= releaseUntil)
+        {
+            const std::size_t stream = heap.top().second;
+            heap.pop();
+            const std::vector<MarketDataEntry> &bars = m_streams[stream];
+            const std::size_t from = next[stream];
+            while (next[stream] < bars.size() && bars[next[stream]].m_timestamp <= releaseUntil)
+            {
+                ++next[stream];
+            }
+            batch.assign(bars.begin() + static_cast<std::ptrdiff_t>(from), bars.begin() + static_cast<std::ptrdiff_t>(next[stream]));
+            m_publish(stream, batch);
+            m_published += batch.size();
+            if (next[stream] < bars.size())
+            {
+                heap.emplace(bars[next[stream]].m_timestamp, stream);
+            }
+        }
+
+        const Clock::time_point now = Clock::now();
+        if (now >= nextReport)
+        {
+            FLASHFEED_LOG_INFO("Replay progress: {}", computeStats(now).summary());
+            nextReport = now + m_options.reportInterval;
+        }
+    }
+
+    m_finished = Clock::now();
+    FLASHFEED_LOG_INFO("Replay {}: {}", m_stopped ? "stopped" : "finished", computeStats(m_finished).summary());
+}
+
+void ReplayEngine::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopped = true;
+    }
+    m_wake.notify_all();
+}
+
+ReplayStats ReplayEngine::stats() const
+{
+    return computeStats(m_finished);
+}
+
+bool ReplayEngine::waitUntil(Clock::time_point deadline)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        if (m_wake.wait_until(lock, deadline - SPIN_MARGIN, [this]
+                              { return m_stopped.load(); }))
+        {
+            return false;
+        }
+    }
+    while (Clock::now() < deadline)
+    {
+        if (m_stopped)
+        {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+ReplayStats ReplayEngine::computeStats(Clock::time_point now) const
+{
+    ReplayStats stats;
+    stats.bars = m_published;
+    stats.elapsed = m_published ? std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_started) : std::chrono::nanoseconds(0);
+    stats.paced = m_options.speed > 0;
+    stats.latenessP50 = percentile(m_latenessNs, 0.50);
+    stats.latenessP99 = percentile(m_latenessNs, 0.99);
+    stats.latenessMax = m_latenessNs.empty() ? std::chrono::nanoseconds(0)
+                                             : std::chrono::nanoseconds(*std::max_element(m_latenessNs.begin(), m_latenessNs.end()));
+    return stats;
+}
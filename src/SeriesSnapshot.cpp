@@ -0,0 +1,205 @@
+#include "SeriesSnapshot.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <boost/crc.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+    constexpr char MAGIC[8] = {'F', 'F', 'S', 'E', 'R', 'I', 'E', 'S'};
+    constexpr std::size_t ALIGNMENT = 64;
+    constexpr std::size_t HEADER_CRC_OFFSET = 52;
+
+    static_assert(sizeof(Timestamp) == sizeof(std::int64_t), "Timestamp column is stored as raw i64 nanoseconds");
+    static_assert(sizeof(double) == 8, "Price columns are stored as f64");
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t formatVersion;
+        std::uint32_t byteOrder;
+        std::uint64_t rowCount;
+        std::uint64_t sequence;
+        std::uint32_t symbolLength;
+        std::uint32_t columnCount;
+        std::uint64_t payloadBytes;
+        std::uint32_t payloadCrc;
+        std::uint32_t headerCrc;
+        std::uint8_t reserved[8];
+    };
+    static_assert(sizeof(Header) == SeriesSnapshot::HEADER_SIZE, "Header must match the documented layout");
+
+    std::size_t padded(std::size_t bytes)
+    {
+        return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    std::uint32_t crc32(const void *data, std::size_t size)
+    {
+        boost::crc_32_type crc;
+        crc.process_bytes(data, size);
+        return crc.checksum();
+    }
+
+    void appendColumn(std::string &out, const void *data, std::size_t bytes)
+    {
+        out.append(static_cast<const char *>(data), bytes);
+        out.append(padded(bytes) - bytes, '\0');
+    }
+}
+
+namespace SeriesSnapshot
+{
+    std::string pathFor(const std::string &directory, const std::string &symbol)
+    {
+        return (std::filesystem::path(directory) / (symbol + FILE_EXTENSION)).string();
+    }
+
+    bool write(const std::string &path, const std::string &symbol, const ColumnarSeries &series, std::string &error)
+    {
+        const std::size_t rows = series.size();
+        const std::size_t columnBytes = rows * 8;
+
+        std::string payload;
+        payload.reserve(padded(symbol.size()) + COLUMN_COUNT * padded(columnBytes));
+        appendColumn(payload, symbol.data(), symbol.size());
+        appendColumn(payload, series.timestamps().data(), columnBytes);
+        appendColumn(payload, series.opens().data(), columnBytes);
+        appendColumn(payload, series.highs().data(), columnBytes);
+        appendColumn(payload, series.lows().data(), columnBytes);
+        appendColumn(payload, series.closes().data(), columnBytes);
+        appendColumn(payload, series.volumes().data(), columnBytes);
+        appendColumn(payload, series.rowSequences().data(), columnBytes);
+
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.formatVersion = FORMAT_VERSION;
+        header.byteOrder = BYTE_ORDER_TAG;
+        header.rowCount = rows;
+        header.sequence = series.sequence();
+        header.symbolLength = static_cast<std::uint32_t>(symbol.size());
+        header.columnCount = COLUMN_COUNT;
+        header.payloadBytes = payload.size();
+        header.payloadCrc = crc32(payload.data(), payload.size());
+        header.headerCrc = crc32(&header, HEADER_CRC_OFFSET);
+
+        const std::string tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file)
+            {
+                error = "cannot create " + tempPath;
+                return false;
+            }
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+            file.flush();
+            if (!file)
+            {
+                error = "write to " + tempPath + " failed";
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec)
+        {
+            error = "cannot rename " + tempPath + ": " + ec.message();
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+    bool read(const std::string &path, std::string &symbol, ColumnarSeries &series, std::string &error)
+    {
+        MappedFile file;
+        if (!file.open(path))
+        {
+            error = "cannot open " + path;
+            return false;
+        }
+        if (file.size() < HEADER_SIZE)
+        {
+            error = "truncated header";
+            return false;
+        }
+
+        Header header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        {
+            error = "not a series snapshot";
+            return false;
+        }
+        if (header.headerCrc != crc32(file.data(), HEADER_CRC_OFFSET))
+        {
+            error = "header checksum mismatch";
+            return false;
+        }
+        // The reserved bytes follow the header checksum, so they are checked by value
+        if (std::any_of(std::begin(header.reserved), std::end(header.reserved), [](std::uint8_t b) { return b != 0; }))
+        {
+            error = "reserved header bytes are not zero";
+            return false;
+        }
+        if (header.byteOrder != BYTE_ORDER_TAG)
+        {
+            error = "written on a host of the other byte order";
+            return false;
+        }
+        if (header.formatVersion != FORMAT_VERSION)
+        {
+            error = "unsupported format version " + std::to_string(header.formatVersion);
+            return false;
+        }
+
+        const std::size_t rows = static_cast<std::size_t>(header.rowCount);
+        const std::size_t columnBytes = padded(rows * 8);
+        if (header.columnCount != COLUMN_COUNT || rows > file.size() / 8 ||
+            header.payloadBytes != padded(header.symbolLength) + COLUMN_COUNT * columnBytes ||
+            header.payloadBytes != file.size() - HEADER_SIZE)
+        {
+            error = "size does not match the header";
+            return false;
+        }
+
+        const char *payload = file.data() + HEADER_SIZE;
+        if (header.payloadCrc != crc32(payload, static_cast<std::size_t>(header.payloadBytes)))
+        {
+            error = "payload checksum mismatch";
+            return false;
+        }
+
+        // The mapping starts on a page and every column on a 64-byte offset, so columns are read in place
+        const char *column = payload + padded(header.symbolLength);
+        auto nextColumn = [&column, columnBytes]()
+        {
+            const char *start = column;
+            column += columnBytes;
+            return start;
+        };
+        const auto *timestamps = reinterpret_cast<const Timestamp *>(nextColumn());
+        const auto *open = reinterpret_cast<const double *>(nextColumn());
+        const auto *high = reinterpret_cast<const double *>(nextColumn());
+        const auto *low = reinterpret_cast<const double *>(nextColumn());
+        const auto *close = reinterpret_cast<const double *>(nextColumn());
+        const auto *volume = reinterpret_cast<const double *>(nextColumn());
+        const auto *rowSequences = reinterpret_cast<const std::uint64_t *>(nextColumn());
+
+        if (!std::is_sorted(timestamps, timestamps + rows))
+        {
+            error = "rows out of timestamp order";
+            return false;
+        }
+
+        symbol.assign(payload, header.symbolLength);
+        series.assignColumns(rows, timestamps, open, high, low, close, volume, rowSequences);
+        series.setSequence(header.sequence);
+        return true;
+    }
+}
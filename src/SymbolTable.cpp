@@ -0,0 +1,46 @@
+#include "SymbolTable.hpp"
+
+std::optional<SymbolId> SymbolTable::intern(const std::string &symbol)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_ids.find(symbol);
+    if (it != m_ids.end())
+    {
+        return it->second;
+    }
+    if (m_names.size() >= MAX_SYMBOLS)
+    {
+        return std::nullopt;
+    }
+    const SymbolId id = static_cast<SymbolId>(m_names.size());
+    m_ids.emplace(symbol, id);
+    m_names.push_back(symbol);
+    return id;
+}
+
+std::optional<SymbolId> SymbolTable::find(const std::string &symbol) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_ids.find(symbol);
+    if (it == m_ids.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<std::string> SymbolTable::name(SymbolId id) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (id >= m_names.size())
+    {
+        return std::nullopt;
+    }
+    return m_names[id];
+}
+
+std::size_t SymbolTable::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_names.size();
+}
@@ -0,0 +1,405 @@
+#include "TimeSeriesStore.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    std::size_t roundUpToChunk(std::size_t rows)
+    {
+        const std::size_t chunk = ColumnarSeries::CHUNK_ELEMENTS;
+        return (rows + chunk - 1) / chunk * chunk;
+    }
+
+    // Bit-for-bit, so a NaN matches itself and a refresh that repeats it is not a change
+    bool sameBits(double a, double b)
+    {
+        return std::memcmp(&a, &b, sizeof(double)) == 0;
+    }
+
+    template <typename T>
+    void copyRows(const AlignedVector<T> &from, std::size_t first, std::size_t rows, AlignedVector<T> &to, std::size_t at)
+    {
+        std::copy(from.begin() + static_cast<std::ptrdiff_t>(first), from.begin() + static_cast<std::ptrdiff_t>(first + rows),
+                  to.begin() + static_cast<std::ptrdiff_t>(at));
+    }
+}
+
+ColumnarSeries::Columns::Columns(std::size_t rows)
+{
+    const std::size_t allocated = roundUpToChunk(rows) + CHUNK_ELEMENTS;
+    timestamps.resize(allocated);
+    open.resize(allocated);
+    high.resize(allocated);
+    low.resize(allocated);
+    close.resize(allocated);
+    volume.resize(allocated);
+    rowSequence.resize(allocated);
+}
+
+ColumnarSeries::ColumnarSeries(const std::vector<MarketDataEntry> &entries)
+{
+    assign(entries);
+}
+
+void ColumnarSeries::clear()
+{
+    // Other versions may still be reading the storage, so it is let go rather than emptied
+    m_columns.reset();
+    m_begin = 0;
+    m_size = 0;
+    m_firstChanged = 0;
+}
+
+void ColumnarSeries::reserve(std::size_t rows)
+{
+    if (!m_columns || m_begin + rows > m_columns->capacity())
+    {
+        relocate(std::max(rows, m_size));
+    }
+}
+
+void ColumnarSeries::append(const MarketDataEntry &entry)
+{
+    if (!canAppendInPlace(1, false))
+    {
+        // Grow geometrically; relocating also drops rows trimmed off the front
+        relocate(std::max(CHUNK_ELEMENTS, m_size * 2));
+    }
+    pushRow(entry, m_sequence);
+}
+
+void ColumnarSeries::assign(const std::vector<MarketDataEntry> &entries)
+{
+    clear();
+    reserve(entries.size());
+    for (const auto &entry : entries)
+    {
+        pushRow(entry, m_sequence);
+    }
+}
+
+void ColumnarSeries::assignColumns(std::size_t rows, const Timestamp *timestamps, const double *open, const double *high,
+                                   const double *low, const double *close, const double *volume, const std::uint64_t *rowSequences)
+{
+    clear();
+    reserve(rows);
+    Columns &columns = *m_columns;
+    std::copy(timestamps, timestamps + rows, columns.timestamps.begin());
+    std::copy(open, open + rows, columns.open.begin());
+    std::copy(high, high + rows, columns.high.begin());
+    std::copy(low, low + rows, columns.low.begin());
+    std::copy(close, close + rows, columns.close.begin());
+    std::copy(volume, volume + rows, columns.volume.begin());
+    std::copy(rowSequences, rowSequences + rows, columns.rowSequence.begin());
+    columns.used = rows;
+    m_size = rows;
+}
+
+bool ColumnarSeries::canAppendInPlace(std::size_t rows, bool shareStorage) const
+{
+    if (!m_columns || (!shareStorage && m_columns.use_count() > 1))
+    {
+        return false;
+    }
+    // Another version already wrote past this one's last row
+    const std::size_t end = m_begin + m_size;
+    return m_columns->used == end && rows <= m_columns->capacity() - end;
+}
+
+void ColumnarSeries::relocate(std::size_t rows)
+{
+    auto columns = std::make_shared<Columns>(std::max(rows, m_size));
+    if (m_columns)
+    {
+        const Columns &from = *m_columns;
+        copyRows(from.timestamps, m_begin, m_size, columns->timestamps, 0);
+        copyRows(from.open, m_begin, m_size, columns->open, 0);
+        copyRows(from.high, m_begin, m_size, columns->high, 0);
+        copyRows(from.low, m_begin, m_size, columns->low, 0);
+        copyRows(from.close, m_begin, m_size, columns->close, 0);
+        copyRows(from.volume, m_begin, m_size, columns->volume, 0);
+        copyRows(from.rowSequence, m_begin, m_size, columns->rowSequence, 0);
+    }
+    columns->used = m_size;
+    m_columns = std::move(columns);
+    m_begin = 0;
+}
+
+void ColumnarSeries::pushRow(const MarketDataEntry &entry, std::uint64_t rowSequence)
+{
+    Columns &columns = *m_columns;
+    const std::size_t at = m_begin + m_size;
+    columns.timestamps[at] = entry.m_timestamp;
+    columns.open[at] = entry.m_open;
+    columns.high[at] = entry.m_high;
+    columns.low[at] = entry.m_low;
+    columns.close[at] = entry.m_close;
+    columns.volume[at] = entry.m_volume;
+    columns.rowSequence[at] = rowSequence;
+    columns.used = at + 1;
+    ++m_size;
+}
+
+void ColumnarSeries::appendRows(const ColumnarSeries &source, std::size_t from, std::size_t to)
+{
+    if (from == to)
+    {
+        return;
+    }
+    const Columns &in = *source.m_columns;
+    Columns &columns = *m_columns;
+    const std::size_t first = source.m_begin + from;
+    const std::size_t rows = to - from;
+    const std::size_t at = m_begin + m_size;
+    copyRows(in.timestamps, first, rows, columns.timestamps, at);
+    copyRows(in.open, first, rows, columns.open, at);
+    copyRows(in.high, first, rows, columns.high, at);
+    copyRows(in.low, first, rows, columns.low, at);
+    copyRows(in.close, first, rows, columns.close, at);
+    copyRows(in.volume, first, rows, columns.volume, at);
+    copyRows(in.rowSequence, first, rows, columns.rowSequence, at);
+    columns.used = at + rows;
+    m_size += rows;
+}
+
+std::size_t ColumnarSeries::trimTo(std::size_t maxRows)
+{
+    if (maxRows == 0 || m_size <= maxRows)
+    {
+        return 0;
+    }
+    // The dropped rows stay in the storage until it is next relocated
+    const std::size_t excess = m_size - maxRows;
+    m_begin += excess;
+    m_size = maxRows;
+    m_firstChanged = m_firstChanged > excess ? m_firstChanged - excess : 0;
+    return excess;
+}
+
+bool ColumnarSeries::sameValues(std::size_t i, const MarketDataEntry &entry) const
+{
+    const Columns &columns = *m_columns;
+    const std::size_t at = m_begin + i;
+    return sameBits(columns.open[at], entry.m_open) && sameBits(columns.high[at], entry.m_high) &&
+           sameBits(columns.low[at], entry.m_low) && sameBits(columns.close[at], entry.m_close) &&
+           sameBits(columns.volume[at], entry.m_volume);
+}
+
+// Two-pointer merge of base and incoming. The counting pass (Build = false) lets
+// merge() return early without copying anything when the update changes nothing.
+template <bool Build>
+SeriesUpdate ColumnarSeries::mergeRows(const ColumnarSeries &base, const std::vector<MarketDataEntry> &incoming, ColumnarSeries &out)
+{
+    SeriesUpdate update;
+    update.previousSequence = base.m_sequence;
+    const std::uint64_t sequence = base.m_sequence + 1;
+    const ColumnView<Timestamp> baseTimestamps = base.timestamps();
+
+    // Everything before the first incoming bar is untouched
+    const Timestamp firstIncoming = incoming.front().m_timestamp;
+    std::size_t i = static_cast<std::size_t>(std::lower_bound(baseTimestamps.begin(), baseTimestamps.end(), firstIncoming) - baseTimestamps.begin());
+    if constexpr (Build)
+    {
+        out.appendRows(base, 0, i);
+        out.m_firstChanged = i;
+    }
+
+    for (std::size_t j = 0; j < incoming.size(); ++j)
+    {
+        const MarketDataEntry &entry = incoming[j];
+        if (j > 0 && incoming[j - 1].m_timestamp == entry.m_timestamp)
+        {
+            continue; // Duplicate bar in the update; the first one wins
+        }
+
+        // Keep existing bars that sort before this one
+        const std::size_t keepFrom = i;
+        while (i < base.size() && baseTimestamps[i] < entry.m_timestamp)
+        {
+            ++i;
+        }
+        if constexpr (Build)
+        {
+            out.appendRows(base, keepFrom, i);
+        }
+
+        if (i == base.size())
+        {
+            ++update.appended;
+            if constexpr (Build)
+            {
+                out.pushRow(entry, sequence);
+            }
+        }
+        else if (baseTimestamps[i] != entry.m_timestamp)
+        {
+            ++update.inserted;
+            if constexpr (Build)
+            {
+                out.pushRow(entry, sequence);
+            }
+        }
+        else
+        {
+            if (base.sameValues(i, entry))
+            {
+                if constexpr (Build)
+                {
+                    out.appendRows(base, i, i + 1);
+                }
+            }
+            else
+            {
+                ++update.replaced;
+                if constexpr (Build)
+                {
+                    out.pushRow(entry, sequence);
+                }
+            }
+            ++i;
+        }
+    }
+    if constexpr (Build)
+    {
+        out.appendRows(base, i, base.size());
+    }
+
+    update.sequence = update.changed() ? sequence : base.m_sequence;
+    return update;
+}
+
+SeriesUpdate ColumnarSeries::appendNewer(const ColumnarSeries &base, const std::vector<MarketDataEntry> &incoming, ColumnarSeries &out,
+                                         std::size_t maxRows)
+{
+    SeriesUpdate update;
+    update.previousSequence = base.m_sequence;
+    update.sequence = base.m_sequence + 1;
+
+    // out starts as another view of base's storage and writes past its last row
+    out = base;
+    if (!out.canAppendInPlace(incoming.size(), true))
+    {
+        out.relocate(std::max(CHUNK_ELEMENTS, (base.size() + incoming.size()) * 2));
+    }
+    out.m_sequence = update.sequence;
+    out.m_firstChanged = out.m_size;
+    for (std::size_t j = 0; j < incoming.size(); ++j)
+    {
+        if (j > 0 && incoming[j - 1].m_timestamp == incoming[j].m_timestamp)
+        {
+            continue; // Duplicate bar; the first one wins, as in mergeRows()
+        }
+        out.pushRow(incoming[j], update.sequence);
+        ++update.appended;
+    }
+    update.removed = out.trimTo(maxRows);
+    return update;
+}
+
+SeriesUpdate ColumnarSeries::merge(const ColumnarSeries &base, const std::vector<MarketDataEntry> &incoming, ColumnarSeries &out,
+                                   std::size_t maxRows)
+{
+    if (incoming.empty())
+    {
+        SeriesUpdate update;
+        update.previousSequence = update.sequence = base.m_sequence;
+        return update;
+    }
+
+    // A live tick or a replayed bar: nothing in base can change, so skip the copy
+    if (base.empty() || base.timestamps()[base.size() - 1] < incoming.front().m_timestamp)
+    {
+        return appendNewer(base, incoming, out, maxRows);
+    }
+
+    SeriesUpdate update = mergeRows<false>(base, incoming, out);
+    if (update.changed())
+    {
+        out.clear();
+        out.reserve(base.size() + update.appended + update.inserted);
+        mergeRows<true>(base, incoming, out);
+        out.m_sequence = update.sequence;
+        update.removed = out.trimTo(maxRows);
+    }
+    return update;
+}
+
+SeriesUpdate ColumnarSeries::replace(const ColumnarSeries &base, const std::vector<MarketDataEntry> &incoming, ColumnarSeries &out,
+                                     std::size_t maxRows)
+{
+    if (base.empty())
+    {
+        return merge(base, incoming, out, maxRows);
+    }
+
+    SeriesUpdate update;
+    update.previousSequence = base.m_sequence;
+    update.sequence = base.m_sequence + 1;
+    update.removed = base.size();
+    update.reset = true;
+
+    out.clear();
+    out.reserve(incoming.size());
+    for (std::size_t j = 0; j < incoming.size(); ++j)
+    {
+        if (j > 0 && incoming[j - 1].m_timestamp == incoming[j].m_timestamp)
+        {
+            continue; // Duplicate bar; the first one wins, as in merge()
+        }
+        out.pushRow(incoming[j], update.sequence);
+    }
+    out.m_sequence = update.sequence;
+    out.trimTo(maxRows);
+    update.appended = out.size();
+    return update;
+}
+
+std::vector<MarketDataEntry> ColumnarSeries::changedSince(std::uint64_t sequence) const
+{
+    std::vector<MarketDataEntry> rows;
+    if (sequence >= m_sequence)
+    {
+        return rows;
+    }
+    // Rows before m_firstChanged carry older sequences, so the previous version's changes start there
+    const std::size_t from = sequence + 1 == m_sequence ? m_firstChanged : 0;
+    const ColumnView<std::uint64_t> rowSequences = this->rowSequences();
+    for (std::size_t i = from; i < m_size; ++i)
+    {
+        if (rowSequences[i] > sequence)
+        {
+            rows.push_back(row(i));
+        }
+    }
+    return rows;
+}
+
+MarketDataEntry ColumnarSeries::row(std::size_t i) const
+{
+    const Columns &columns = *m_columns;
+    const std::size_t at = m_begin + i;
+    return MarketDataEntry(columns.timestamps[at], columns.open[at], columns.high[at], columns.low[at], columns.close[at],
+                           columns.volume[at]);
+}
+
+std::vector<MarketDataEntry> ColumnarSeries::toEntries() const
+{
+    std::vector<MarketDataEntry> entries;
+    entries.reserve(size());
+    for (std::size_t i = 0; i < size(); ++i)
+    {
+        entries.push_back(row(i));
+    }
+    return entries;
+}
+
+void to_json(nlohmann::json &j, const ColumnarSeries &series)
+{
+    j = nlohmann::json::array();
+    auto &rows = j.get_ref<nlohmann::json::array_t &>();
+    rows.reserve(series.size());
+    for (std::size_t i = 0; i < series.size(); ++i)
+    {
+        rows.push_back(series.row(i));
+    }
+}
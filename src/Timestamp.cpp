@@ -0,0 +1,176 @@
+#include "Timestamp.hpp"
+
+namespace
+{
+    constexpr std::int64_t NANOS_PER_SECOND = 1000000000;
+    constexpr std::int64_t SECONDS_PER_DAY = 86400;
+
+    // Days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant's days_from_civil)
+    constexpr std::int64_t daysFromCivil(std::int64_t y, unsigned m, unsigned d)
+    {
+        y -= m <= 2;
+        const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+        const unsigned yoe = static_cast<unsigned>(y - era * 400);
+        const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+    }
+
+    // Inverse of daysFromCivil
+    constexpr void civilFromDays(std::int64_t z, std::int64_t &y, unsigned &m, unsigned &d)
+    {
+        z += 719468;
+        const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        const unsigned doe = static_cast<unsigned>(z - era * 146097);
+        const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned mp = (5 * doy + 2) / 153;
+        d = doy - (153 * mp + 2) / 5 + 1;
+        m = mp < 10 ? mp + 3 : mp - 9;
+        y = static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2);
+    }
+
+    constexpr bool isLeapYear(std::int64_t y)
+    {
+        return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    }
+
+    constexpr unsigned daysInMonth(std::int64_t y, unsigned m)
+    {
+        constexpr unsigned days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        return (m == 2 && isLeapYear(y)) ? 29 : days[m - 1];
+    }
+
+    // Reads exactly `count` digits at text[pos]
+    inline bool readDigits(std::string_view text, std::size_t pos, std::size_t count, unsigned &out)
+    {
+        if (pos + count > text.size())
+        {
+            return false;
+        }
+        unsigned value = 0;
+        for (std::size_t i = pos; i < pos + count; ++i)
+        {
+            const unsigned digit = static_cast<unsigned>(text[i] - '0');
+            if (digit > 9)
+            {
+                return false;
+            }
+            value = value * 10 + digit;
+        }
+        out = value;
+        return true;
+    }
+
+    inline void writeDigits(char *out, unsigned value, std::size_t count)
+    {
+        for (std::size_t i = count; i-- > 0;)
+        {
+            out[i] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+    }
+}
+
+bool Timestamp::parse(std::string_view text, Timestamp &out)
+{
+    // Fixed layout: YYYY-MM-DD?HH:MM:SS, positions 0..18
+    unsigned year, month, day, hour, minute, second;
+    if (text.size() < 19 ||
+        !readDigits(text, 0, 4, year) || text[4] != '-' ||
+        !readDigits(text, 5, 2, month) || text[7] != '-' ||
+        !readDigits(text, 8, 2, day) || (text[10] != 'T' && text[10] != ' ') ||
+        !readDigits(text, 11, 2, hour) || text[13] != ':' ||
+        !readDigits(text, 14, 2, minute) || text[16] != ':' ||
+        !readDigits(text, 17, 2, second))
+    {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month) ||
+        hour > 23 || minute > 59 || second > 59)
+    {
+        return false;
+    }
+
+    std::int64_t fraction = 0;
+    if (text.size() > 19)
+    {
+        // Optional ".f" to ".fffffffff", scaled to nanoseconds
+        const std::size_t digits = text.size() - 20;
+        if (text[19] != '.' || digits == 0 || digits > 9)
+        {
+            return false;
+        }
+        unsigned value;
+        if (!readDigits(text, 20, digits, value))
+        {
+            return false;
+        }
+        fraction = value;
+        for (std::size_t i = digits; i < 9; ++i)
+        {
+            fraction *= 10;
+        }
+    }
+
+    const std::int64_t seconds = daysFromCivil(year, month, day) * SECONDS_PER_DAY +
+                                 static_cast<std::int64_t>(hour) * 3600 + minute * 60 + second;
+    out.m_nanos = seconds * NANOS_PER_SECOND + fraction;
+    return true;
+}
+
+std::size_t Timestamp::format(char *out, char separator) const
+{
+    std::int64_t seconds = m_nanos / NANOS_PER_SECOND;
+    std::int64_t fraction = m_nanos % NANOS_PER_SECOND;
+    if (fraction < 0)
+    {
+        fraction += NANOS_PER_SECOND;
+        --seconds;
+    }
+    std::int64_t days = seconds / SECONDS_PER_DAY;
+    std::int64_t secondOfDay = seconds % SECONDS_PER_DAY;
+    if (secondOfDay < 0)
+    {
+        secondOfDay += SECONDS_PER_DAY;
+        --days;
+    }
+
+    std::int64_t year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+
+    writeDigits(out, static_cast<unsigned>(year), 4);
+    out[4] = '-';
+    writeDigits(out + 5, month, 2);
+    out[7] = '-';
+    writeDigits(out + 8, day, 2);
+    out[10] = separator;
+    writeDigits(out + 11, static_cast<unsigned>(secondOfDay / 3600), 2);
+    out[13] = ':';
+    writeDigits(out + 14, static_cast<unsigned>(secondOfDay / 60 % 60), 2);
+    out[16] = ':';
+    writeDigits(out + 17, static_cast<unsigned>(secondOfDay % 60), 2);
+
+    if (fraction == 0)
+    {
+        return 19;
+    }
+
+    // Milli-, micro- or nanosecond precision, whichever is the shortest exact form
+    std::size_t digits = 9;
+    while (digits > 3 && fraction % 1000 == 0)
+    {
+        fraction /= 1000;
+        digits -= 3;
+    }
+    out[19] = '.';
+    writeDigits(out + 20, static_cast<unsigned>(fraction), digits);
+    return 20 + digits;
+}
+
+std::string Timestamp::toString(char separator) const
+{
+    char buffer[MAX_FORMATTED_LENGTH];
+    return std::string(buffer, format(buffer, separator));
+}
@@ -0,0 +1,319 @@
+#include "WireProtocol.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+    constexpr std::string_view DATA_SIZE_PREFIX = "DATA_SIZE:";
+    constexpr std::string_view SNAPSHOT_PREFIX = "SNAPSHOT:";
+    constexpr std::string_view UPDATE_PREFIX = "UPDATE:";
+    constexpr std::string_view HELLO_PREFIX = "HELLO:";
+    constexpr std::string_view ERROR_PREFIX = "ERROR:";
+    constexpr std::string_view STATS_PREFIX = "STATS:";
+
+    bool startsWith(std::string_view text, std::string_view prefix)
+    {
+        return text.substr(0, prefix.size()) == prefix;
+    }
+
+    // Splits off the text up to the next ':' (or the whole remainder)
+    std::string_view nextField(std::string_view &rest)
+    {
+        std::size_t colon = rest.find(':');
+        std::string_view field = rest.substr(0, colon);
+        rest = (colon == std::string_view::npos) ? std::string_view() : rest.substr(colon + 1);
+        return field;
+    }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    constexpr bool HOST_IS_LITTLE_ENDIAN = false;
+#else
+    constexpr bool HOST_IS_LITTLE_ENDIAN = true;
+#endif
+
+    // On little-endian hosts a MarketDataEntry already is a wire record, so whole
+    // row arrays can be copied in one go
+    static_assert(sizeof(MarketDataEntry) == WireProtocol::BINARY_RECORD_SIZE, "MarketDataEntry must match the wire record");
+    static_assert(offsetof(MarketDataEntry, m_timestamp) == 0 && offsetof(MarketDataEntry, m_open) == 8 &&
+                      offsetof(MarketDataEntry, m_high) == 16 && offsetof(MarketDataEntry, m_low) == 24 &&
+                      offsetof(MarketDataEntry, m_close) == 32 && offsetof(MarketDataEntry, m_volume) == 40,
+                  "MarketDataEntry field offsets must match the wire record");
+
+    template <typename T>
+    T byteSwap(T value)
+    {
+        T swapped = 0;
+        for (std::size_t i = 0; i < sizeof(T); ++i)
+        {
+            swapped = static_cast<T>((swapped << 8) | (value & 0xFF));
+            value = static_cast<T>(value >> 8);
+        }
+        return swapped;
+    }
+
+    template <typename T>
+    void storeLE(char *out, T value)
+    {
+        if constexpr (!HOST_IS_LITTLE_ENDIAN)
+        {
+            value = byteSwap(value);
+        }
+        std::memcpy(out, &value, sizeof(T));
+    }
+
+    template <typename T>
+    T loadLE(const char *in)
+    {
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        if constexpr (!HOST_IS_LITTLE_ENDIAN)
+        {
+            value = byteSwap(value);
+        }
+        return value;
+    }
+
+    void storeDouble(char *out, double value)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        storeLE(out, bits);
+    }
+
+    double loadDouble(const char *in)
+    {
+        std::uint64_t bits = loadLE<std::uint64_t>(in);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    template <typename T>
+    bool parseNumber(std::string_view text, T &out)
+    {
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+        return ec == std::errc() && ptr == text.data() + text.size() && !text.empty();
+    }
+}
+
+namespace WireProtocol
+{
+    std::string makeDataHeader(std::size_t payloadSize)
+    {
+        return std::string(DATA_SIZE_PREFIX) + std::to_string(payloadSize) + "\n";
+    }
+
+    std::string makeSnapshotHeader(const std::string &symbol, std::uint64_t sequence, std::size_t payloadSize)
+    {
+        return std::string(SNAPSHOT_PREFIX) + symbol + ":" + std::to_string(sequence) + ":" + std::to_string(payloadSize) + "\n";
+    }
+
+    std::string makeUpdateHeader(const std::string &symbol, std::uint64_t previousSequence, std::uint64_t sequence,
+                                 Timestamp firstTimestamp, std::size_t payloadSize)
+    {
+        return std::string(UPDATE_PREFIX) + symbol + ":" + std::to_string(previousSequence) + ":" +
+               std::to_string(sequence) + ":" + std::to_string(firstTimestamp.m_nanos) + ":" + std::to_string(payloadSize) + "\n";
+    }
+
+    std::string makeStatsHeader(std::size_t payloadSize)
+    {
+        return std::string(STATS_PREFIX) + std::to_string(payloadSize) + "\n";
+    }
+
+    bool parseFrameHeader(std::string_view line, FrameHeader &out)
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+
+        out = FrameHeader();
+        if (startsWith(line, DATA_SIZE_PREFIX))
+        {
+            out.type = FrameType::Data;
+            return parseNumber(line.substr(DATA_SIZE_PREFIX.size()), out.payloadSize);
+        }
+        if (startsWith(line, SNAPSHOT_PREFIX))
+        {
+            std::string_view rest = line.substr(SNAPSHOT_PREFIX.size());
+            out.type = FrameType::Snapshot;
+            out.symbol = std::string(nextField(rest));
+            return !out.symbol.empty() &&
+                   parseNumber(nextField(rest), out.sequence) &&
+                   parseNumber(nextField(rest), out.payloadSize) && rest.empty();
+        }
+        if (startsWith(line, UPDATE_PREFIX))
+        {
+            std::string_view rest = line.substr(UPDATE_PREFIX.size());
+            out.type = FrameType::Update;
+            out.symbol = std::string(nextField(rest));
+            return !out.symbol.empty() &&
+                   parseNumber(nextField(rest), out.previousSequence) &&
+                   parseNumber(nextField(rest), out.sequence) &&
+                   parseNumber(nextField(rest), out.firstTimestamp.m_nanos) &&
+                   parseNumber(nextField(rest), out.payloadSize) && rest.empty();
+        }
+        if (startsWith(line, HELLO_PREFIX))
+        {
+            out.type = FrameType::Hello;
+            out.text = std::string(line.substr(HELLO_PREFIX.size()));
+            return true;
+        }
+        if (startsWith(line, ERROR_PREFIX))
+        {
+            out.type = FrameType::Error;
+            out.text = std::string(line.substr(ERROR_PREFIX.size()));
+            return true;
+        }
+        if (startsWith(line, STATS_PREFIX))
+        {
+            out.type = FrameType::Stats;
+            return parseNumber(line.substr(STATS_PREFIX.size()), out.payloadSize);
+        }
+        return false;
+    }
+
+    std::string makeBinaryHeader(FrameType type, std::uint32_t symbolId, std::uint32_t count,
+                                 std::uint64_t previousSequence, std::uint64_t sequence, std::size_t payloadSize,
+                                 Timestamp firstTimestamp)
+    {
+        std::string header(BINARY_HEADER_SIZE, '\0');
+        char *out = header.data();
+        out[0] = static_cast<char>(BINARY_MAGIC);
+        out[1] = static_cast<char>(type);
+        storeLE<std::uint32_t>(out + 4, symbolId);
+        storeLE<std::uint32_t>(out + 8, count);
+        storeLE<std::uint32_t>(out + 12, static_cast<std::uint32_t>(payloadSize));
+        storeLE<std::uint64_t>(out + 16, previousSequence);
+        storeLE<std::uint64_t>(out + 24, sequence);
+        storeLE<std::uint64_t>(out + 32, static_cast<std::uint64_t>(firstTimestamp.m_nanos));
+        return header;
+    }
+
+    bool parseBinaryHeader(const char *data, FrameHeader &out)
+    {
+        out = FrameHeader();
+        if (static_cast<std::uint8_t>(data[0]) != BINARY_MAGIC)
+        {
+            return false;
+        }
+
+        const auto type = static_cast<FrameType>(static_cast<std::uint8_t>(data[1]));
+        switch (type)
+        {
+        case FrameType::Data:
+        case FrameType::Snapshot:
+        case FrameType::Update:
+        case FrameType::Error:
+        case FrameType::Symbol:
+        case FrameType::Stats:
+            break;
+        default:
+            return false; // HELLO replies are always text
+        }
+
+        out.type = type;
+        out.symbolId = loadLE<std::uint32_t>(data + 4);
+        out.count = loadLE<std::uint32_t>(data + 8);
+        out.payloadSize = loadLE<std::uint32_t>(data + 12);
+        out.previousSequence = loadLE<std::uint64_t>(data + 16);
+        out.sequence = loadLE<std::uint64_t>(data + 24);
+        out.firstTimestamp = Timestamp(static_cast<std::int64_t>(loadLE<std::uint64_t>(data + 32)));
+        return true;
+    }
+
+    void appendBinaryRecord(std::string &out, const MarketDataEntry &entry)
+    {
+        char record[BINARY_RECORD_SIZE];
+        storeLE<std::uint64_t>(record, static_cast<std::uint64_t>(entry.m_timestamp.m_nanos));
+        storeDouble(record + 8, entry.m_open);
+        storeDouble(record + 16, entry.m_high);
+        storeDouble(record + 24, entry.m_low);
+        storeDouble(record + 32, entry.m_close);
+        storeDouble(record + 40, entry.m_volume);
+        out.append(record, BINARY_RECORD_SIZE);
+    }
+
+    void encodeBinaryRecords(const std::vector<MarketDataEntry> &rows, std::string &out)
+    {
+        if constexpr (HOST_IS_LITTLE_ENDIAN)
+        {
+            out.append(reinterpret_cast<const char *>(rows.data()), rows.size() * BINARY_RECORD_SIZE);
+        }
+        else
+        {
+            out.reserve(out.size() + rows.size() * BINARY_RECORD_SIZE);
+            for (const auto &entry : rows)
+            {
+                appendBinaryRecord(out, entry);
+            }
+        }
+    }
+
+    bool decodeBinaryRecords(std::string_view payload, std::vector<MarketDataEntry> &out)
+    {
+        if (payload.size() % BINARY_RECORD_SIZE != 0)
+        {
+            return false;
+        }
+
+        const std::size_t count = payload.size() / BINARY_RECORD_SIZE;
+        if (count == 0)
+        {
+            return true; // An empty payload's data() may be null, which memcpy must not see
+        }
+        const std::size_t first = out.size();
+        out.resize(first + count);
+        if constexpr (HOST_IS_LITTLE_ENDIAN)
+        {
+            std::memcpy(out.data() + first, payload.data(), payload.size());
+        }
+        else
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const char *record = payload.data() + i * BINARY_RECORD_SIZE;
+                MarketDataEntry &entry = out[first + i];
+                entry.m_timestamp = Timestamp(static_cast<std::int64_t>(loadLE<std::uint64_t>(record)));
+                entry.m_open = loadDouble(record + 8);
+                entry.m_high = loadDouble(record + 16);
+                entry.m_low = loadDouble(record + 24);
+                entry.m_close = loadDouble(record + 32);
+                entry.m_volume = loadDouble(record + 40);
+            }
+        }
+        return true;
+    }
+
+    void applyDelta(std::vector<MarketDataEntry> &local, const std::vector<MarketDataEntry> &delta, Timestamp firstTimestamp)
+    {
+        auto byTimestamp = [](const MarketDataEntry &a, const MarketDataEntry &b)
+        { return a.m_timestamp < b.m_timestamp; };
+
+        for (const auto &entry : delta)
+        {
+            // Deltas are almost always at the tail, so appending is the common case
+            if (local.empty() || local.back().m_timestamp < entry.m_timestamp)
+            {
+                local.push_back(entry);
+                continue;
+            }
+            auto it = std::lower_bound(local.begin(), local.end(), entry, byTimestamp);
+            if (it != local.end() && it->m_timestamp == entry.m_timestamp)
+            {
+                *it = entry;
+            }
+            else
+            {
+                local.insert(it, entry);
+            }
+        }
+
+        // Rows the server's row limit dropped; usually none, or a few at the front
+        auto firstKept = std::find_if(local.begin(), local.end(), [firstTimestamp](const MarketDataEntry &entry)
+                                      { return !(entry.m_timestamp < firstTimestamp); });
+        local.erase(local.begin(), firstKept);
+    }
+}
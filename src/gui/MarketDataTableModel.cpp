@@ -36,7 +36,7 @@ QVariant MarketDataTableModel::data(const QModelIndex &index, int role) const
 
     if (role == Qt::DisplayRole) { // The data to be displayed as text
         switch (index.column()) {
-            case 0: return QString::fromStdString(entry.m_timestamp);
+            case 0: return QString::fromStdString(entry.m_timestamp.toString(Timestamp::EDGE_SEPARATOR));
             case 1: return entry.m_open;  // QVariant can handle double
             case 2: return entry.m_high;
             case 3: return entry.m_low;
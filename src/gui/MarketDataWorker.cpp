@@ -6,6 +6,12 @@
 #include <boost/asio/read.hpp>
 #include <boost/asio/read_until.hpp>
 #include <boost/asio/write.hpp>
+#ifdef FLASHFEED_USE_COROUTINES
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#endif
 #include <nlohmann/json.hpp> 
 #include <sstream>
 
@@ -29,6 +35,8 @@ MarketDataWorker::MarketDataWorker(QObject *parent)
     : QObject(parent),
       m_ioContext(std::make_unique<net::io_context>()), // Initialize io_context
       m_resolver(*m_ioContext), // Initialize resolver with the io_context
+      m_connectTimer(*m_ioContext),
+      m_writeTimer(*m_ioContext),
       m_isConnected(false)
 {
     qDebug() << "MarketDataWorker instance created in thread:" << qThreadIdToString(QThread::currentThreadId());
@@ -197,8 +205,109 @@ void MarketDataWorker::processConnect(const QString &address, int port)
 
     m_socket = std::make_shared<tcp::socket>(*m_ioContext);
     emit statusMessage(QString("Worker: Resolving %1:%2...").arg(address).arg(port));
+#ifdef FLASHFEED_USE_COROUTINES
+    net::co_spawn(*m_ioContext, connectAndRead(address.toStdString(), QString::number(port).toStdString()), net::detached);
+#else
     doResolve(address, QString::number(port));
+#endif
 }
+
+#ifdef FLASHFEED_USE_COROUTINES
+net::awaitable<void> MarketDataWorker::connectAndRead(std::string host, std::string port)
+{
+    boost::system::error_code ec;
+    const auto endpoints = co_await m_resolver.async_resolve(host, port, net::redirect_error(net::use_awaitable, ec));
+    qDebug() << "MarketDataWorker (Asio std::thread" << threadIdToString(std::this_thread::get_id()) << "): Resolved" << host.c_str() << ":" << port.c_str() << ". EC:" << ec.message().c_str();
+    if (!onResolved(ec))
+    {
+        co_return;
+    }
+
+    armTimeout(m_connectTimer, CONNECT_TIMEOUT, "Connect");
+    co_await net::async_connect(*m_socket, endpoints, net::redirect_error(net::use_awaitable, ec));
+    if (onConnected(ec))
+    {
+        co_await readFrames();
+    }
+}
+
+net::awaitable<void> MarketDataWorker::readFrames()
+{
+    boost::system::error_code ec;
+    while (m_isConnected && m_socket && m_socket->is_open())
+    {
+        bool hasPayload = true;
+        if (m_binaryMode)
+        {
+            co_await fillBuffer(WireProtocol::BINARY_HEADER_SIZE, ec);
+            if (ec)
+            {
+                break;
+            }
+            if (!consumeBinaryHeader())
+            {
+                ec = net::error::misc_errors::not_found;
+                break;
+            }
+        }
+        else
+        {
+            co_await net::async_read_until(*m_socket, m_responseBuffer, "\n", net::redirect_error(net::use_awaitable, ec));
+            if (ec)
+            {
+                break;
+            }
+            hasPayload = consumeHeaderLine();
+        }
+
+        if (hasPayload)
+        {
+            co_await fillBuffer(m_pendingFrame.payloadSize, ec);
+            if (ec)
+            {
+                break;
+            }
+            consumePayload(m_pendingFrame.payloadSize);
+        }
+    }
+
+    if (ec)
+    {
+        onSocketError(ec);
+    }
+}
+
+net::awaitable<void> MarketDataWorker::fillBuffer(std::size_t size, boost::system::error_code &ec)
+{
+    // Bytes left in the buffer belong to the next frame, so only the shortfall is read
+    const std::size_t buffered = m_responseBuffer.size();
+    if (buffered < size)
+    {
+        co_await net::async_read(*m_socket, m_responseBuffer, net::transfer_exactly(size - buffered),
+                                 net::redirect_error(net::use_awaitable, ec));
+    }
+}
+
+net::awaitable<void> MarketDataWorker::writeQueued()
+{
+    // Drains the queue; queueWrite starts a new writer once it has emptied
+    for (;;)
+    {
+        if (!m_socket || !m_socket->is_open())
+        {
+            m_writeQueue.clear();
+            break;
+        }
+        boost::system::error_code ec;
+        armTimeout(m_writeTimer, WRITE_TIMEOUT, "Send");
+        co_await net::async_write(*m_socket, net::buffer(m_writeQueue.front().text), net::redirect_error(net::use_awaitable, ec));
+        if (!onWritten(ec))
+        {
+            break;
+        }
+    }
+}
+#else
 void MarketDataWorker::doResolve(const QString &address, const QString &portStr)
 {
     qDebug() << "MarketDataWorker (QThread" << qThreadIdToString(QThread::currentThreadId()) << "): In doResolve. Posting async_resolve for" << address << ":" << portStr;
@@ -215,21 +324,15 @@ void MarketDataWorker::doResolve(const QString &address, const QString &portStr)
 void MarketDataWorker::handleResolve(const boost::system::error_code &ec,
                                      const tcp::resolver::results_type &endpoints)
 {
-    if (ec)
+    if (onResolved(ec))
     {
-        qDebug() << "MarketDataWorker (thread" << QThread::currentThreadId() << "): Resolve error -" << ec.message().c_str();
-        emit statusMessage(QString("Worker: Resolve error: %1").arg(ec.message().c_str()));
-        emit connectionError(QString("Resolve failed: %1").arg(ec.message().c_str()));
-        return;
+        doConnect(endpoints);
     }
-
-    qDebug() << "MarketDataWorker (thread" << QThread::currentThreadId() << "): Resolve successful. Attempting connect.";
-    emit statusMessage("Worker: Host resolved. Connecting...");
-    doConnect(endpoints);
 }
 
 void MarketDataWorker::doConnect(const tcp::resolver::results_type &endpoints)
 {
+    armTimeout(m_connectTimer, CONNECT_TIMEOUT, "Connect");
     net::async_connect(*m_socket, endpoints,
                        [this](const boost::system::error_code &ec, const tcp::endpoint & /*endpoint*/)
                        {
@@ -239,18 +342,53 @@ void MarketDataWorker::doConnect(const tcp::resolver::results_type &endpoints)
 
 void MarketDataWorker::handleConnect(const boost::system::error_code &ec)
 {
+    if (onConnected(ec))
+    {
+        doReadHeader();
+    }
+}
+#endif
+
+bool MarketDataWorker::onResolved(const boost::system::error_code &ec)
+{
+    if (ec)
+    {
+        qDebug() << "MarketDataWorker (thread" << QThread::currentThreadId() << "): Resolve error -" << ec.message().c_str();
+        emit statusMessage(QString("Worker: Resolve error: %1").arg(ec.message().c_str()));
+        emit connectionError(QString("Resolve failed: %1").arg(ec.message().c_str()));
+        return false;
+    }
+
+    qDebug() << "MarketDataWorker (thread" << QThread::currentThreadId() << "): Resolve successful. Attempting connect.";
+    emit statusMessage("Worker: Host resolved. Connecting...");
+    return true;
+}
+
+bool MarketDataWorker::onConnected(const boost::system::error_code &ec)
+{
+    m_connectTimer.expires_at(net::steady_timer::time_point::max()); // Disarm; also cancels the wait
     try
     {
         if (ec)
         {
             qDebug() << "MarketDataWorker (Asio std::thread" << threadIdToString(std::this_thread::get_id()) << "): Connect error -" << ec.message().c_str();
+            emit connectionError(QString("Connect failed: %1").arg(ec.message().c_str()));
             closeSocket();
-            return;
+            return false;
         }
         qDebug() << "MarketDataWorker (Asio std::thread" << threadIdToString(std::this_thread::get_id()) << "): Connect successful!";
         m_isConnected = true;
+        m_symbolStates.clear();
+        m_writeQueue.clear();
+        m_binaryMode = false;
+        m_symbolNames.clear();
         emit statusMessage("Worker: Connection successful!");
         emit connectedToServer();
+
+        // Ask for snapshot + incremental updates instead of full history on every refresh,
+        // as packed binary records rather than JSON
+        queueWrite("HELLO DELTA BINARY\n");
+        return true;
     }
     catch (const std::exception &e)
     {
@@ -261,9 +399,27 @@ void MarketDataWorker::handleConnect(const boost::system::error_code &ec)
             if(m_isConnected){ m_isConnected = false; emit disconnectedFromServer(); } }, Qt::QueuedConnection);
         if (m_workGuard)
             m_workGuard->reset(); // Allow service to stop if it's a fatal error for the io_context loop
+        return false;
     }
 }
 
+void MarketDataWorker::armTimeout(net::steady_timer &timer, std::chrono::seconds timeout, const char *operation)
+{
+    timer.expires_after(timeout);
+    timer.async_wait([this, &timer, operation](const boost::system::error_code &ec)
+                     {
+        // Disarmed timers are moved to the far future, so a wait that completed
+        // just as the operation finished is ignored as well
+        if (ec || timer.expiry() > net::steady_timer::clock_type::now())
+        {
+            return;
+        }
+        qWarning() << "MarketDataWorker:" << operation << "timed out.";
+        emit statusMessage(QString("Worker: %1 timed out.").arg(operation));
+        closeSocket(); // The pending operation completes with an error and reports it
+    });
+}
+
 void MarketDataWorker::processSubscribe(const QString &symbol)
 {
     qDebug() << "MarketDataWorker (thread" << QThread::currentThreadId() << "): processSubscribe called for" << symbol;
@@ -274,36 +430,85 @@ void MarketDataWorker::processSubscribe(const QString &symbol)
         return;
     }
 
+    const std::string newSymbol = symbol.toStdString();
+    const std::string previousSymbol = m_currentSymbol.toStdString();
     m_currentSymbol = symbol; // Store the symbol we are subscribing to
     emit statusMessage(QString("Worker: Subscribing to %1...").arg(symbol));
-    doWriteSubscribe();
+
+    net::post(*m_ioContext, [this, symbol, newSymbol, previousSymbol]()
+              {
+        if (!previousSymbol.empty() && previousSymbol != newSymbol)
+        {
+            // The table shows one symbol at a time, so stop the server pushing the old one
+            queueWrite("UNSUBSCRIBE " + previousSymbol + "\n");
+            m_symbolStates.erase(previousSymbol);
+        }
+        m_symbolStates[newSymbol]; // Frames are only applied to subscribed symbols
+        queueWrite("SUBSCRIBE " + newSymbol + "\n", [this, symbol]()
+                   {
+            qDebug() << "MarketDataWorker (thread" << QThread::currentThreadId() << "): Subscribe message sent for" << symbol;
+            emit statusMessage(QString("Worker: Subscribe request sent for %1.").arg(symbol));
+            emit subscribedToSymbol(symbol); }); });
 }
 
-void MarketDataWorker::doWriteSubscribe()
+void MarketDataWorker::queueWrite(std::string text, std::function<void()> onSent)
 {
-    std::string request = "SUBSCRIBE " + m_currentSymbol.toStdString() + "\n";
-    net::async_write(*m_socket, net::buffer(request),
+    // Must run on the Asio thread; the queue owns each buffer until its write completes
+    const bool writeInProgress = !m_writeQueue.empty();
+    m_writeQueue.push_back(OutgoingMessage{std::move(text), std::move(onSent)});
+    if (!writeInProgress)
+    {
+#ifdef FLASHFEED_USE_COROUTINES
+        net::co_spawn(*m_ioContext, writeQueued(), net::detached);
+#else
+        doWrite();
+#endif
+    }
+}
+
+#ifndef FLASHFEED_USE_COROUTINES
+void MarketDataWorker::doWrite()
+{
+    if (!m_socket || !m_socket->is_open())
+    {
+        m_writeQueue.clear();
+        return;
+    }
+    armTimeout(m_writeTimer, WRITE_TIMEOUT, "Send");
+    net::async_write(*m_socket, net::buffer(m_writeQueue.front().text),
                      [this](const boost::system::error_code &ec, std::size_t bytes_transferred)
                      {
-                         handleWriteSubscribe(ec, bytes_transferred);
+                         handleWrite(ec, bytes_transferred);
                      });
 }
 
-void MarketDataWorker::handleWriteSubscribe(const boost::system::error_code &ec, std::size_t /*bytes_transferred*/)
+void MarketDataWorker::handleWrite(const boost::system::error_code &ec, std::size_t /*bytes_transferred*/)
 {
-    if (ec)
+    if (onWritten(ec))
     {
-        qDebug() << "MarketDataWorker (thread" << QThread::currentThreadId() << "): Write subscribe error -" << ec.message().c_str();
-        emit statusMessage(QString("Worker: Subscribe send error: %1").arg(ec.message().c_str()));
-        emit subscriptionError(m_currentSymbol, QString("Failed to send subscribe request: %1").arg(ec.message().c_str()));
-        return;
+        doWrite();
     }
+}
+#endif
 
-    qDebug() << "MarketDataWorker (thread" << QThread::currentThreadId() << "): Subscribe message sent for" << m_currentSymbol;
-    emit statusMessage(QString("Worker: Subscribe request sent for %1.").arg(m_currentSymbol));
-    emit subscribedToSymbol(m_currentSymbol);
+bool MarketDataWorker::onWritten(const boost::system::error_code &ec)
+{
+    m_writeTimer.expires_at(net::steady_timer::time_point::max()); // Disarm; also cancels the wait
+    if (ec)
+    {
+        qDebug() << "MarketDataWorker (thread" << QThread::currentThreadId() << "): Write error -" << ec.message().c_str();
+        emit statusMessage(QString("Worker: Send error: %1").arg(ec.message().c_str()));
+        m_writeQueue.clear();
+        return false; // The pending read reports the broken connection
+    }
 
-    doReadHeader();
+    OutgoingMessage sent = std::move(m_writeQueue.front());
+    m_writeQueue.pop_front();
+    if (sent.onSent)
+    {
+        sent.onSent();
+    }
+    return !m_writeQueue.empty();
 }
 
 void MarketDataWorker::processDisconnect()
@@ -325,6 +530,7 @@ void MarketDataWorker::processDisconnect()
 
 void MarketDataWorker::closeSocket()
 {
+    m_resolver.cancel();
     if (m_socket && m_socket->is_open())
     {
         boost::system::error_code ec;
@@ -346,6 +552,7 @@ void MarketDataWorker::closeSocket()
     }
 }
 
+#ifndef FLASHFEED_USE_COROUTINES
 void MarketDataWorker::doReadHeader()
 {
     if (!m_isConnected || !m_socket || !m_socket->is_open())
@@ -354,7 +561,19 @@ void MarketDataWorker::doReadHeader()
         return;
     }
     qDebug() << "MarketDataWorker (thread" << QThread::currentThreadId() << "): Starting async_read_until for header.";
-    m_responseBuffer.consume(m_responseBuffer.size()); // Clear buffer before new read
+    // Bytes left in the buffer belong to the next frame, so they are kept
+
+    if (m_binaryMode)
+    {
+        const std::size_t buffered = m_responseBuffer.size();
+        const std::size_t needed = buffered < WireProtocol::BINARY_HEADER_SIZE ? WireProtocol::BINARY_HEADER_SIZE - buffered : 0;
+        net::async_read(*m_socket, m_responseBuffer, net::transfer_exactly(needed),
+                        [this](const boost::system::error_code &ec, std::size_t bytes_transferred)
+                        {
+                            handleReadBinaryHeader(ec, bytes_transferred);
+                        });
+        return;
+    }
 
     net::async_read_until(*m_socket, m_responseBuffer, "\n",
                           [this](const boost::system::error_code &ec, std::size_t bytes_transferred)
@@ -363,7 +582,7 @@ void MarketDataWorker::doReadHeader()
                           });
 }
 
-void MarketDataWorker::handleReadHeader(const boost::system::error_code &ec, std::size_t bytes_transferred)
+void MarketDataWorker::handleReadBinaryHeader(const boost::system::error_code &ec, std::size_t /*bytes_transferred*/)
 {
     if (ec)
     {
@@ -371,40 +590,31 @@ void MarketDataWorker::handleReadHeader(const boost::system::error_code &ec, std
         return;
     }
 
-    if (bytes_transferred > 0)
+    if (!consumeBinaryHeader())
     {
-        std::istream header_stream(&m_responseBuffer);
-        std::string header_line;
-        std::getline(header_stream, header_line);
+        onSocketError(net::error::misc_errors::not_found);
+        return;
+    }
+    doReadPayload(m_pendingFrame.payloadSize);
+}
 
-        qDebug() << "MarketDataWorker: Received header line:" << header_line.c_str();
+void MarketDataWorker::handleReadHeader(const boost::system::error_code &ec, std::size_t bytes_transferred)
+{
+    if (ec)
+    {
+        onSocketError(ec);
+        return;
+    }
 
-        if (header_line.rfind("DATA_SIZE:", 0) == 0)
-        {
-            try
-            {
-                std::size_t payloadSize = std::stoull(header_line.substr(10));
-                qDebug() << "MarketDataWorker: Expecting payload of size" << payloadSize;
-                doReadPayload(payloadSize);
-            }
-            catch (const std::exception &e)
-            {
-                qWarning() << "MarketDataWorker: Error parsing DATA_SIZE from header:" << e.what();
-                emit statusMessage(QString("Worker: Invalid DATA_SIZE header: %1").arg(e.what()));
-                doReadHeader();
-            }
-        }
-        else if (header_line.rfind("ERROR:", 0) == 0)
+    if (bytes_transferred > 0)
+    {
+        if (consumeHeaderLine())
         {
-            qWarning() << "MarketDataWorker: Received ERROR from server:" << header_line.substr(6).c_str();
-            emit statusMessage(QString("Worker: Server error: %1").arg(header_line.substr(6).c_str()));
-            doReadHeader();
+            doReadPayload(m_pendingFrame.payloadSize);
         }
         else
         {
-            qWarning() << "MarketDataWorker: Received unknown header:" << header_line.c_str();
-            emit statusMessage(QString("Worker: Unknown server message: %1").arg(header_line.c_str()));
-            doReadHeader(); // Try to read next header
+            doReadHeader();
         }
     }
     else
@@ -447,46 +657,222 @@ void MarketDataWorker::handleReadPayload(const boost::system::error_code &ec, st
 
     if (m_responseBuffer.size() >= expectedPayloadSize)
     {
-        // We have enough data for the payload
-        const char *data_ptr = net::buffer_cast<const char *>(m_responseBuffer.data());
-        std::string payload_str(data_ptr, expectedPayloadSize);
-        m_responseBuffer.consume(expectedPayloadSize); // Consume the processed payload
+        consumePayload(expectedPayloadSize);
+        doReadHeader();
+    }
+    else
+    {
+        qWarning() << "MarketDataWorker::handleReadPayload: Did not receive full payload. Expected"
+                   << expectedPayloadSize << "got" << m_responseBuffer.size();
+        onSocketError(net::error::misc_errors::not_found);
+    }
+}
+#endif
 
-        qDebug() << "MarketDataWorker: Received payload of size" << payload_str.length();
+bool MarketDataWorker::consumeBinaryHeader()
+{
+    WireProtocol::FrameHeader header;
+    const char *data_ptr = net::buffer_cast<const char *>(m_responseBuffer.data());
+    if (!WireProtocol::parseBinaryHeader(data_ptr, header))
+    {
+        // Nothing after a bad header can be framed reliably
+        qWarning() << "MarketDataWorker: Received invalid binary frame header.";
+        emit statusMessage("Worker: Invalid binary frame from server.");
+        return false;
+    }
+    m_responseBuffer.consume(WireProtocol::BINARY_HEADER_SIZE);
 
-        try
+    auto name = m_symbolNames.find(header.symbolId);
+    if (name != m_symbolNames.end())
+    {
+        header.symbol = name->second;
+    }
+    m_pendingFrame = std::move(header);
+    return true;
+}
+
+bool MarketDataWorker::consumeHeaderLine()
+{
+    std::istream header_stream(&m_responseBuffer);
+    std::string header_line;
+    std::getline(header_stream, header_line);
+
+    qDebug() << "MarketDataWorker: Received header line:" << header_line.c_str();
+
+    WireProtocol::FrameHeader header;
+    if (!WireProtocol::parseFrameHeader(header_line, header))
+    {
+        qWarning() << "MarketDataWorker: Received unknown header:" << header_line.c_str();
+        emit statusMessage(QString("Worker: Unknown server message: %1").arg(header_line.c_str()));
+        return false; // Try to read next header
+    }
+
+    switch (header.type)
+    {
+    case WireProtocol::FrameType::Hello:
+        emit statusMessage(QString("Worker: Server accepted options: %1").arg(header.text.c_str()));
+        m_binaryMode = header.text.find("BINARY") != std::string::npos;
+        return false;
+    case WireProtocol::FrameType::Error:
+        qWarning() << "MarketDataWorker: Received ERROR from server:" << header.text.c_str();
+        emit statusMessage(QString("Worker: Server error: %1").arg(header.text.c_str()));
+        return false;
+    default:
+        qDebug() << "MarketDataWorker: Expecting payload of size" << header.payloadSize;
+        m_pendingFrame = std::move(header);
+        return true;
+    }
+}
+
+void MarketDataWorker::consumePayload(std::size_t payloadSize)
+{
+    const char *data_ptr = net::buffer_cast<const char *>(m_responseBuffer.data());
+    std::string payload_str(data_ptr, payloadSize);
+    m_responseBuffer.consume(payloadSize); // Consume the processed payload
+
+    qDebug() << "MarketDataWorker: Received payload of size" << payload_str.length();
+
+    if (m_binaryMode)
+    {
+        handleBinaryPayload(payload_str);
+        return;
+    }
+
+    try
+    {
+        json jsonData = json::parse(payload_str);
+        if (jsonData.is_array())
         {
-            json jsonData = json::parse(payload_str);
-            if (jsonData.is_array())
-            {
-                std::vector<MarketDataEntry> entries = jsonData.get<std::vector<MarketDataEntry>>();
-                emit statusMessage(QString("Worker: Parsed %1 entries for %2.").arg(entries.size()).arg(m_currentSymbol));
-                emit newDataArrived(m_currentSymbol, entries);
-            }
-            else
-            {
-                qWarning() << "MarketDataWorker: Received JSON payload is not an array.";
-                emit statusMessage("Worker: Invalid data format received (not an array).");
-            }
+            handleFrame(m_pendingFrame, jsonData.get<std::vector<MarketDataEntry>>());
         }
-        catch (const json::parse_error &e)
+        else
         {
-            qWarning() << "MarketDataWorker: JSON parse error -" << e.what();
-            emit statusMessage(QString("Worker: Data parse error: %1").arg(e.what()));
+            qWarning() << "MarketDataWorker: Received JSON payload is not an array.";
+            emit statusMessage("Worker: Invalid data format received (not an array).");
         }
-        catch (const std::exception &e)
+    }
+    catch (const json::parse_error &e)
+    {
+        qWarning() << "MarketDataWorker: JSON parse error -" << e.what();
+        emit statusMessage(QString("Worker: Data parse error: %1").arg(e.what()));
+    }
+    catch (const std::exception &e)
+    {
+        qWarning() << "MarketDataWorker: Data processing error -" << e.what();
+        emit statusMessage(QString("Worker: Data processing error: %1").arg(e.what()));
+    }
+}
+
+void MarketDataWorker::handleBinaryPayload(const std::string &payload)
+{
+    switch (m_pendingFrame.type)
+    {
+    case WireProtocol::FrameType::Symbol:
+        m_symbolNames[m_pendingFrame.symbolId] = payload;
+        break;
+    case WireProtocol::FrameType::Error:
+        qWarning() << "MarketDataWorker: Received ERROR from server:" << payload.c_str();
+        emit statusMessage(QString("Worker: Server error: %1").arg(payload.c_str()));
+        break;
+    default:
+    {
+        std::vector<MarketDataEntry> rows;
+        if (!WireProtocol::decodeBinaryRecords(payload, rows) || rows.size() != m_pendingFrame.count)
         {
-            qWarning() << "MarketDataWorker: Data processing error -" << e.what();
-            emit statusMessage(QString("Worker: Data processing error: %1").arg(e.what()));
+            qWarning() << "MarketDataWorker: Binary payload does not match its record count.";
+            emit statusMessage("Worker: Invalid binary data received.");
+            break;
         }
+        if (m_pendingFrame.type != WireProtocol::FrameType::Data && m_pendingFrame.symbol.empty())
+        {
+            qWarning() << "MarketDataWorker: Binary frame for unknown symbol id" << m_pendingFrame.symbolId;
+            break;
+        }
+        handleFrame(m_pendingFrame, std::move(rows));
+        break;
+    }
+    }
+}
 
-        doReadHeader();
+void MarketDataWorker::handleFrame(const WireProtocol::FrameHeader &header, std::vector<MarketDataEntry> rows)
+{
+    switch (header.type)
+    {
+    case WireProtocol::FrameType::Data:
+    {
+        // Legacy full-history frame; it does not name its symbol
+        emit statusMessage(QString("Worker: Parsed %1 entries for %2.").arg(rows.size()).arg(m_currentSymbol));
+        emit newDataArrived(m_currentSymbol, rows);
+        break;
     }
-    else
+    case WireProtocol::FrameType::Snapshot:
     {
-        qWarning() << "MarketDataWorker::handleReadPayload: Did not receive full payload. Expected"
-                   << expectedPayloadSize << "got" << m_responseBuffer.size();
-        onSocketError(net::error::misc_errors::not_found);
+        auto it = m_symbolStates.find(header.symbol);
+        if (it == m_symbolStates.end())
+        {
+            break; // Unsubscribed while the snapshot was in flight
+        }
+        SymbolState &state = it->second;
+        state.entries = std::move(rows);
+        state.sequence = header.sequence;
+        state.haveSnapshot = true;
+        state.resyncRequested = false;
+        emit statusMessage(QString("Worker: Snapshot of %1 entries for %2 (seq %3).")
+                               .arg(state.entries.size())
+                               .arg(header.symbol.c_str())
+                               .arg(header.sequence));
+        emit newDataArrived(QString::fromStdString(header.symbol), state.entries);
+        break;
+    }
+    case WireProtocol::FrameType::Update:
+    {
+        auto it = m_symbolStates.find(header.symbol);
+        if (it == m_symbolStates.end())
+        {
+            break;
+        }
+        SymbolState &state = it->second;
+        if (!state.haveSnapshot)
+        {
+            // Usually the snapshot is still on its way, but a slow-consumer policy may
+            // have dropped it; one resync covers both cases
+            if (!state.resyncRequested)
+            {
+                state.resyncRequested = true;
+                queueWrite("RESYNC " + header.symbol + "\n");
+            }
+            break;
+        }
+        if (header.sequence <= state.sequence)
+        {
+            break; // Already covered by the snapshot we hold
+        }
+        if (header.previousSequence > state.sequence)
+        {
+            // Missed at least one update; the local copy can no longer be patched
+            if (!state.resyncRequested)
+            {
+                state.resyncRequested = true;
+                emit statusMessage(QString("Worker: Sequence gap for %1 (have %2, update from %3). Resyncing.")
+                                       .arg(header.symbol.c_str())
+                                       .arg(state.sequence)
+                                       .arg(header.previousSequence));
+                queueWrite("RESYNC " + header.symbol + "\n");
+            }
+            break;
+        }
+
+        WireProtocol::applyDelta(state.entries, rows, header.firstTimestamp);
+        state.sequence = header.sequence;
+        emit statusMessage(QString("Worker: Applied %1 updated entries for %2 (seq %3).")
+                               .arg(rows.size())
+                               .arg(header.symbol.c_str())
+                               .arg(header.sequence));
+        emit newDataArrived(QString::fromStdString(header.symbol), state.entries);
+        break;
+    }
+    default:
+        break;
     }
 }
 
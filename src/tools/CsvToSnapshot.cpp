@@ -0,0 +1,136 @@
+#include "DataParser.hpp"
+#include "Logger.hpp"
+#include "SeriesSnapshot.hpp"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Converts CSV bar files into the snapshot files the server restores at
+// startup (see SeriesSnapshot.hpp), then reads each one back and checks it
+// against the CSV rows.
+//
+// Usage: Market_Parser_Snapshot_Converter [output dir] [SYMBOL=file.csv ...]
+// The output directory defaults to ./snapshots. Without files, every
+// market_data_<SYMBOL>.csv in the data folder is converted.
+
+namespace
+{
+    // market_data_AAPL.csv -> AAPL
+    std::string symbolFromFileName(const std::filesystem::path &path)
+    {
+        std::string stem = path.stem().string();
+        const std::string prefix = "market_data_";
+        return stem.compare(0, prefix.size(), prefix) == 0 ? stem.substr(prefix.size()) : stem;
+    }
+
+    bool sameRows(const ColumnarSeries &series, const std::vector<MarketDataEntry> &rows)
+    {
+        if (series.size() != rows.size())
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < rows.size(); ++i)
+        {
+            MarketDataEntry row = series.row(i);
+            if (row.m_timestamp != rows[i].m_timestamp || row.m_open != rows[i].m_open || row.m_high != rows[i].m_high ||
+                row.m_low != rows[i].m_low || row.m_close != rows[i].m_close || row.m_volume != rows[i].m_volume)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool convert(const std::string &symbol, const std::string &csvPath, const std::string &outputDir)
+    {
+        auto parser = ParserFactory::createCSVParser(csvPath);
+        if (!parser->parseData())
+        {
+            std::cerr << symbol << ": cannot parse " << csvPath << "\n";
+            return false;
+        }
+
+        // The sequence a first CSV merge into an empty cache would give
+        ColumnarSeries series;
+        series.setSequence(1);
+        series.assign(parser->getData());
+
+        const std::string path = SeriesSnapshot::pathFor(outputDir, symbol);
+        std::string error;
+        if (!SeriesSnapshot::write(path, symbol, series, error))
+        {
+            std::cerr << symbol << ": " << error << "\n";
+            return false;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::string storedSymbol;
+        ColumnarSeries restored;
+        bool readBack = SeriesSnapshot::read(path, storedSymbol, restored, error);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        if (!readBack || storedSymbol != symbol || !sameRows(restored, parser->getData()))
+        {
+            std::cerr << symbol << ": snapshot does not read back correctly" << (error.empty() ? "" : ": " + error) << "\n";
+            return false;
+        }
+
+        std::cout << symbol << ": " << series.size() << " bars, " << std::filesystem::file_size(path) << " bytes -> " << path
+                  << " (read back in " << elapsed.count() << " us)\n";
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Logger::getInstance().setLogFile("snapshot_converter_log.txt");
+
+    const std::string outputDir = argc > 1 ? argv[1] : "snapshots";
+    std::vector<std::pair<std::string, std::string>> inputs; // Symbol, CSV path
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+        auto equals = argument.find('=');
+        if (equals == std::string::npos)
+        {
+            inputs.emplace_back(symbolFromFileName(argument), argument);
+        }
+        else
+        {
+            inputs.emplace_back(argument.substr(0, equals), argument.substr(equals + 1));
+        }
+    }
+    if (inputs.empty())
+    {
+        std::error_code ec;
+        for (const auto &entry : std::filesystem::directory_iterator(DATA_FOLDER, ec))
+        {
+            if (entry.path().extension() == ".csv")
+            {
+                inputs.emplace_back(symbolFromFileName(entry.path()), entry.path().string());
+            }
+        }
+        if (inputs.empty())
+        {
+            std::cerr << "No CSV files found in " << DATA_FOLDER << "\n";
+            return 1;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(outputDir, ec);
+    if (ec)
+    {
+        std::cerr << "Cannot create " << outputDir << ": " << ec.message() << "\n";
+        return 1;
+    }
+
+    int failures = 0;
+    for (const auto &[symbol, csvPath] : inputs)
+    {
+        failures += convert(symbol, csvPath, outputDir) ? 0 : 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/**
+ * @brief Minimal checks for the in-tree unit tests.
+ *
+ * A failed check prints its location and carries on, so one run reports
+ * every broken case. main() ends with `return test::finish("TestName");`,
+ * which exits non-zero if anything failed so CTest marks the test failed.
+ *
+ *     FLASHFEED_CHECK(series.empty());
+ *     FLASHFEED_CHECK_EQ(update.appended, 2u);
+ */
+namespace test
+{
+    inline int &failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline void fail(const char *file, int line, const std::string &message)
+    {
+        ++failures();
+        std::cerr << file << ":" << line << ": check failed: " << message << "\n";
+    }
+
+    template <typename Actual, typename Expected>
+    void checkEqual(const Actual &actual, const Expected &expected, const char *actualText, const char *expectedText,
+                    const char *file, int line)
+    {
+        if (!(actual == expected))
+        {
+            std::ostringstream message;
+            message << actualText << " == " << expectedText << " (got " << actual << ", expected " << expected << ")";
+            fail(file, line, message.str());
+        }
+    }
+
+    inline int finish(const char *name)
+    {
+        if (failures() > 0)
+        {
+            std::cerr << name << ": " << failures() << " check(s) failed\n";
+            return 1;
+        }
+        std::cout << name << ": all checks passed\n";
+        return 0;
+    }
+}
+
+#define FLASHFEED_CHECK(condition)                           \
+    do                                                       \
+    {                                                        \
+        if (!(condition))                                    \
+        {                                                    \
+            test::fail(__FILE__, __LINE__, #condition);      \
+        }                                                    \
+    } while (false)
+
+#define FLASHFEED_CHECK_EQ(actual, expected) \
+    test::checkEqual((actual), (expected), #actual, #expected, __FILE__, __LINE__)
@@ -0,0 +1,223 @@
+#include "TestCheck.hpp"
+#include "TimeSeriesStore.hpp"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// ColumnarSeries merge, replace and changedSince: what changes and how it is
+// counted, row sequence stamping, the row limit, and that versions sharing
+// storage are not disturbed when a newer one appends.
+
+namespace
+{
+    MarketDataEntry bar(std::int64_t minute, double close)
+    {
+        return MarketDataEntry(Timestamp(minute * 60 * 1000000000LL), close - 1, close + 1, close - 2, close, 100);
+    }
+
+    std::vector<double> closes(const ColumnarSeries &series)
+    {
+        return std::vector<double>(series.closes().begin(), series.closes().end());
+    }
+
+    std::vector<std::int64_t> minutes(const std::vector<MarketDataEntry> &rows)
+    {
+        std::vector<std::int64_t> out;
+        for (const auto &row : rows)
+        {
+            out.push_back(row.m_timestamp.m_nanos / (60 * 1000000000LL));
+        }
+        return out;
+    }
+
+    void mergeCountsAppendsInsertsAndReplacements()
+    {
+        ColumnarSeries empty;
+        ColumnarSeries first;
+        SeriesUpdate update = ColumnarSeries::merge(empty, {bar(1, 10), bar(3, 30), bar(5, 50)}, first);
+        FLASHFEED_CHECK_EQ(update.appended, 3u);
+        FLASHFEED_CHECK_EQ(update.previousSequence, 0u);
+        FLASHFEED_CHECK_EQ(update.sequence, 1u);
+        FLASHFEED_CHECK_EQ(first.sequence(), 1u);
+
+        // 2 and 4 land between existing bars, 5 changes, 6 is new, 1 is repeated as is
+        ColumnarSeries second;
+        update = ColumnarSeries::merge(first, {bar(1, 10), bar(2, 20), bar(4, 40), bar(5, 55), bar(6, 60)}, second);
+        FLASHFEED_CHECK_EQ(update.appended, 1u);
+        FLASHFEED_CHECK_EQ(update.inserted, 2u);
+        FLASHFEED_CHECK_EQ(update.replaced, 1u);
+        FLASHFEED_CHECK_EQ(update.removed, 0u);
+        FLASHFEED_CHECK(!update.reset);
+        FLASHFEED_CHECK_EQ(update.sequence, 2u);
+        FLASHFEED_CHECK(closes(second) == std::vector<double>({10, 20, 30, 40, 55, 60}));
+
+        // Untouched rows keep the sequence they were written at
+        const std::vector<std::uint64_t> rowSequences(second.rowSequences().begin(), second.rowSequences().end());
+        FLASHFEED_CHECK(rowSequences == std::vector<std::uint64_t>({1, 2, 1, 2, 2, 2}));
+
+        // The earlier version still holds what it held
+        FLASHFEED_CHECK(closes(first) == std::vector<double>({10, 30, 50}));
+    }
+
+    void unchangedRefreshIsNotAChange()
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        ColumnarSeries empty;
+        ColumnarSeries base;
+        ColumnarSeries::merge(empty, {bar(1, 10), bar(2, nan)}, base);
+
+        ColumnarSeries out;
+        const SeriesUpdate update = ColumnarSeries::merge(base, {bar(1, 10), bar(2, nan)}, out);
+        FLASHFEED_CHECK(!update.changed());
+        FLASHFEED_CHECK_EQ(update.sequence, base.sequence());
+        FLASHFEED_CHECK(out.empty()); // Not written when nothing changed
+
+        FLASHFEED_CHECK(!ColumnarSeries::merge(base, {}, out).changed());
+
+        // -0.0 and 0.0 compare equal as doubles but are different values
+        ColumnarSeries zero;
+        ColumnarSeries::merge(empty, {bar(1, 0.0)}, zero);
+        FLASHFEED_CHECK(ColumnarSeries::merge(zero, {bar(1, -0.0)}, out).changed());
+    }
+
+    void duplicateIncomingBarsKeepTheFirst()
+    {
+        ColumnarSeries empty;
+        ColumnarSeries out;
+        SeriesUpdate update = ColumnarSeries::merge(empty, {bar(1, 10), bar(1, 11), bar(2, 20), bar(2, 21)}, out);
+        FLASHFEED_CHECK_EQ(update.appended, 2u);
+        FLASHFEED_CHECK(closes(out) == std::vector<double>({10, 20}));
+
+        // Same through the slow path, with a bar before the last one
+        ColumnarSeries merged;
+        update = ColumnarSeries::merge(out, {bar(0, 5), bar(0, 6), bar(3, 30)}, merged);
+        FLASHFEED_CHECK_EQ(update.inserted, 1u);
+        FLASHFEED_CHECK_EQ(update.appended, 1u);
+        FLASHFEED_CHECK(closes(merged) == std::vector<double>({5, 10, 20, 30}));
+    }
+
+    void changedSinceReturnsRowsWrittenLater()
+    {
+        ColumnarSeries empty;
+        ColumnarSeries v1;
+        ColumnarSeries v2;
+        ColumnarSeries v3;
+        ColumnarSeries::merge(empty, {bar(1, 10), bar(2, 20), bar(3, 30)}, v1);
+        ColumnarSeries::merge(v1, {bar(2, 22)}, v2);             // Replaces a middle row
+        ColumnarSeries::merge(v2, {bar(4, 40), bar(5, 50)}, v3); // Appends
+
+        FLASHFEED_CHECK(minutes(v3.changedSince(2)) == std::vector<std::int64_t>({4, 5}));
+        FLASHFEED_CHECK(minutes(v3.changedSince(1)) == std::vector<std::int64_t>({2, 4, 5}));
+        FLASHFEED_CHECK(minutes(v3.changedSince(0)) == std::vector<std::int64_t>({1, 2, 3, 4, 5}));
+        FLASHFEED_CHECK(v3.changedSince(3).empty());
+        FLASHFEED_CHECK(v3.changedSince(7).empty());
+        FLASHFEED_CHECK(minutes(v2.changedSince(1)) == std::vector<std::int64_t>({2}));
+
+        const std::vector<MarketDataEntry> rows = v3.changedSince(2);
+        FLASHFEED_CHECK_EQ(rows.size(), 2u);
+        if (rows.size() == 2)
+        {
+            FLASHFEED_CHECK_EQ(rows[1].m_close, 50.0);
+            FLASHFEED_CHECK_EQ(rows[1].m_high, 51.0);
+        }
+    }
+
+    void rowLimitDropsTheOldestBars()
+    {
+        ColumnarSeries empty;
+        ColumnarSeries v1;
+        SeriesUpdate update = ColumnarSeries::merge(empty, {bar(1, 10), bar(2, 20), bar(3, 30)}, v1, 4);
+        FLASHFEED_CHECK_EQ(update.removed, 0u);
+
+        ColumnarSeries v2;
+        update = ColumnarSeries::merge(v1, {bar(4, 40), bar(5, 50), bar(6, 60)}, v2, 4);
+        FLASHFEED_CHECK_EQ(update.appended, 3u);
+        FLASHFEED_CHECK_EQ(update.removed, 2u);
+        FLASHFEED_CHECK(closes(v2) == std::vector<double>({30, 40, 50, 60}));
+        FLASHFEED_CHECK(minutes(v2.changedSince(1)) == std::vector<std::int64_t>({4, 5, 6}));
+
+        // An insert through the slow path is trimmed the same way
+        ColumnarSeries v3;
+        update = ColumnarSeries::merge(v2, {bar(5, 55), bar(7, 70)}, v3, 4);
+        FLASHFEED_CHECK_EQ(update.removed, 1u);
+        FLASHFEED_CHECK(closes(v3) == std::vector<double>({40, 55, 60, 70}));
+
+        // Many single-bar appends stay at the limit, and each keeps its row
+        ColumnarSeries current = v3;
+        for (std::int64_t minute = 8; minute < 200; ++minute)
+        {
+            ColumnarSeries next;
+            update = ColumnarSeries::merge(current, {bar(minute, static_cast<double>(minute))}, next, 4);
+            FLASHFEED_CHECK_EQ(update.removed, 1u);
+            current = next;
+        }
+        FLASHFEED_CHECK(closes(current) == std::vector<double>({196, 197, 198, 199}));
+        FLASHFEED_CHECK(minutes(current.changedSince(current.sequence() - 1)) == std::vector<std::int64_t>({199}));
+    }
+
+    void replaceResetsTheSeries()
+    {
+        ColumnarSeries empty;
+        ColumnarSeries base;
+        ColumnarSeries::merge(empty, {bar(1, 10), bar(2, 20), bar(3, 30)}, base);
+
+        ColumnarSeries out;
+        SeriesUpdate update = ColumnarSeries::replace(base, {bar(2, 21), bar(9, 90), bar(9, 91)}, out);
+        FLASHFEED_CHECK(update.reset);
+        FLASHFEED_CHECK(update.changed());
+        FLASHFEED_CHECK_EQ(update.removed, 3u);
+        FLASHFEED_CHECK_EQ(update.appended, 2u);
+        FLASHFEED_CHECK_EQ(update.sequence, base.sequence() + 1);
+        FLASHFEED_CHECK(closes(out) == std::vector<double>({21, 90}));
+        FLASHFEED_CHECK_EQ(out.changedSince(base.sequence()).size(), 2u);
+
+        // Replacing an empty series is a plain merge
+        update = ColumnarSeries::replace(empty, {bar(1, 10)}, out);
+        FLASHFEED_CHECK(!update.reset);
+        FLASHFEED_CHECK_EQ(update.appended, 1u);
+    }
+
+    void versionsSharingStorageStayIntact()
+    {
+        // Each version appends in place after the previous one; none may see the others' rows
+        std::vector<ColumnarSeries> versions(1);
+        for (std::int64_t minute = 1; minute <= 100; ++minute)
+        {
+            ColumnarSeries next;
+            ColumnarSeries::merge(versions.back(), {bar(minute, static_cast<double>(minute))}, next);
+            versions.push_back(next);
+        }
+        for (std::size_t v = 0; v < versions.size(); ++v)
+        {
+            FLASHFEED_CHECK_EQ(versions[v].size(), v);
+            FLASHFEED_CHECK(v == 0 || versions[v].closes()[v - 1] == static_cast<double>(v));
+        }
+
+        // An older version growing again must not overwrite what a newer one appended
+        ColumnarSeries branch;
+        ColumnarSeries::merge(versions[50], {bar(51, -1)}, branch);
+        FLASHFEED_CHECK_EQ(branch.closes()[50], -1.0);
+        FLASHFEED_CHECK_EQ(versions[100].closes()[50], 51.0);
+
+        // Copies share storage but append independently
+        ColumnarSeries copy = versions[100];
+        copy.append(bar(101, 1));
+        ColumnarSeries other = versions[100];
+        other.append(bar(101, 2));
+        FLASHFEED_CHECK_EQ(copy.closes()[100], 1.0);
+        FLASHFEED_CHECK_EQ(other.closes()[100], 2.0);
+        FLASHFEED_CHECK_EQ(versions[100].size(), 100u);
+    }
+}
+
+int main()
+{
+    mergeCountsAppendsInsertsAndReplacements();
+    unchangedRefreshIsNotAChange();
+    duplicateIncomingBarsKeepTheFirst();
+    changedSinceReturnsRowsWrittenLater();
+    rowLimitDropsTheOldestBars();
+    replaceResetsTheSeries();
+    versionsSharingStorageStayIntact();
+    return test::finish("TestColumnarSeries");
+}
@@ -0,0 +1,96 @@
+#include "CsvScanner.hpp"
+#include "MappedFile.hpp"
+#include "TestCheck.hpp"
+#include <random>
+#include <string>
+#include <vector>
+
+// Every SIMD kernel the CPU supports must build exactly the index the scalar
+// loop builds, including around the 16- and 32-byte block edges and for a
+// last row without a trailing newline.
+
+namespace
+{
+    const CsvScanner::Kernel SIMD_KERNELS[] = {CsvScanner::Kernel::SSE2, CsvScanner::Kernel::AVX2};
+
+    void checkKernelsAgree(const std::string &buffer)
+    {
+        CsvScanner::StructuralIndex expected;
+        FLASHFEED_CHECK(CsvScanner::buildIndex(buffer, expected, CsvScanner::Kernel::Scalar));
+        for (CsvScanner::Kernel kernel : SIMD_KERNELS)
+        {
+            if (!CsvScanner::isKernelSupported(kernel))
+            {
+                continue;
+            }
+            CsvScanner::StructuralIndex index;
+            FLASHFEED_CHECK(CsvScanner::buildIndex(buffer, index, kernel));
+            if (index.delimiters != expected.delimiters || index.rowEnds != expected.rowEnds)
+            {
+                test::fail(__FILE__, __LINE__, std::string(CsvScanner::kernelName(kernel)) + " index differs for a " +
+                                                   std::to_string(buffer.size()) + "-byte buffer");
+            }
+        }
+    }
+
+    void scalarIndexOfKnownRows()
+    {
+        const std::string buffer = "a,b\n1,2,3\n\nx";
+        CsvScanner::StructuralIndex index;
+        FLASHFEED_CHECK(CsvScanner::buildIndex(buffer, index, CsvScanner::Kernel::Scalar));
+        const std::vector<std::uint32_t> delimiters = {1, 3, 5, 7, 9, 10};
+        const std::vector<std::uint32_t> rowEnds = {2, 5, 6, 6};
+        FLASHFEED_CHECK(index.delimiters == delimiters);
+        FLASHFEED_CHECK(index.rowEnds == rowEnds);
+    }
+
+    void kernelsAgreeOnBlockEdges()
+    {
+        // A delimiter at every position of the first few blocks, alone and in runs
+        for (std::size_t length = 0; length <= 100; ++length)
+        {
+            for (std::size_t at = 0; at < length; ++at)
+            {
+                std::string buffer(length, '7');
+                buffer[at] = (at % 2) ? ',' : '\n';
+                checkKernelsAgree(buffer);
+            }
+            checkKernelsAgree(std::string(length, ','));
+            checkKernelsAgree(std::string(length, '\n'));
+        }
+    }
+
+    void kernelsAgreeOnRandomBuffers()
+    {
+        static const char ALPHABET[] = "0123456789.-:, \n\"";
+        std::mt19937 random(20240611);
+        for (int round = 0; round < 2000; ++round)
+        {
+            std::string buffer(random() % 300, ' ');
+            for (char &c : buffer)
+            {
+                c = ALPHABET[random() % (sizeof(ALPHABET) - 1)];
+            }
+            checkKernelsAgree(buffer);
+        }
+    }
+
+    void kernelsAgreeOnSampleData()
+    {
+        MappedFile sample(std::string(DATA_FOLDER) + "/market_data_AAPL.csv");
+        FLASHFEED_CHECK(sample.isOpen());
+        if (sample.isOpen())
+        {
+            checkKernelsAgree(std::string(sample.view()));
+        }
+    }
+}
+
+int main()
+{
+    scalarIndexOfKnownRows();
+    kernelsAgreeOnBlockEdges();
+    kernelsAgreeOnRandomBuffers();
+    kernelsAgreeOnSampleData();
+    return test::finish("TestCsvScanner");
+}
@@ -0,0 +1,185 @@
+#include "FetchScheduler.hpp"
+#include "TestCheck.hpp"
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// FetchScheduler's repeat detection against a scripted loopback upstream: a
+// response is only flagged unchanged when it repeats one the handler kept, so
+// good -> failure -> identical good is taken in full again.
+
+namespace
+{
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+    namespace net = boost::asio;
+    using tcp = net::ip::tcp;
+
+    struct Reply
+    {
+        http::status status;
+        std::string body;
+        bool etag = true; // Send an ETag, and answer 304 when the request carries it
+    };
+
+    // Serves one reply per request, in order, on keep-alive connections
+    class ScriptedUpstream
+    {
+    public:
+        explicit ScriptedUpstream(std::vector<Reply> script)
+            : m_script(std::move(script)),
+              m_acceptor(m_io, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0)),
+              m_thread([this] { serve(); })
+        {
+        }
+
+        ~ScriptedUpstream() { m_thread.join(); }
+
+        std::string port() const { return std::to_string(m_acceptor.local_endpoint().port()); }
+
+        // If-None-Match of each request, once the scheduler has stopped
+        const std::vector<std::string> &conditions() const { return m_conditions; }
+
+    private:
+        void serve()
+        {
+            while (m_conditions.size() < m_script.size())
+            {
+                tcp::socket socket(m_io);
+                beast::error_code ec;
+                m_acceptor.accept(socket, ec);
+                if (ec)
+                {
+                    return;
+                }
+                beast::flat_buffer buffer;
+                while (m_conditions.size() < m_script.size())
+                {
+                    http::request<http::empty_body> request;
+                    http::read(socket, buffer, request, ec);
+                    if (ec)
+                    {
+                        break; // Closed by the client
+                    }
+                    const Reply &reply = m_script[m_conditions.size()];
+                    m_conditions.emplace_back(request[http::field::if_none_match]);
+
+                    const std::string etag = "\"" + std::to_string(std::hash<std::string>()(reply.body)) + "\"";
+                    const bool notModified = reply.etag && reply.status == http::status::ok && m_conditions.back() == etag;
+                    http::response<http::string_body> response{notModified ? http::status::not_modified : reply.status, request.version()};
+                    if (reply.etag)
+                    {
+                        response.set(http::field::etag, etag);
+                    }
+                    if (!notModified)
+                    {
+                        response.body() = reply.body;
+                    }
+                    response.keep_alive(true);
+                    response.prepare_payload();
+                    http::write(socket, response, ec);
+                    if (ec)
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+
+        std::vector<Reply> m_script;
+        net::io_context m_io;
+        tcp::acceptor m_acceptor;
+        std::vector<std::string> m_conditions;
+        std::thread m_thread;
+    };
+
+    struct Step
+    {
+        Reply reply;
+        bool kept;              // What the handler answers
+        bool expectOk;
+        bool expectUnchanged;
+        bool expectConditional; // The request carried the previous ETag
+    };
+
+    void failedAndRejectedResultsAreNotRepeats()
+    {
+        const std::string bars = R"json({"Time Series (1min)": {"2024-03-01 16:00:00": {"1. open": "1"}}})json";
+        const std::string note = R"json({"Note": "rate limited"})json";
+        const std::vector<Step> steps = {
+            {{http::status::ok, bars}, true, true, false, false},
+            {{http::status::internal_server_error, "down"}, false, false, false, true},
+            // Same body as before the outage: taken in full, not answered from the old validators
+            {{http::status::ok, bars}, true, true, false, false},
+            {{http::status::ok, bars}, true, false, true, true}, // 304
+            // An API message the handler does not keep, then the same message again
+            {{http::status::ok, note}, false, true, false, true},
+            {{http::status::ok, note}, true, true, false, false},
+            // Without validators, repeats are found by the body hash
+            {{http::status::ok, note, false}, false, true, true, true},
+            {{http::status::ok, note, false}, true, true, false, false},
+            {{http::status::ok, note, false}, true, true, true, false},
+        };
+
+        std::vector<Reply> script;
+        for (const auto &step : steps)
+        {
+            script.push_back(step.reply);
+        }
+        ScriptedUpstream upstream(script);
+
+        FetchOptions options;
+        options.port = upstream.port();
+        options.useTls = false;
+        options.maxConcurrent = 1;
+        options.timeout = std::chrono::seconds(5);
+
+        net::io_context ioc(1);
+        std::size_t results = 0;
+        FetchScheduler *running = nullptr;
+        FetchScheduler scheduler(ioc, "127.0.0.1", options,
+                                 [&](const std::string &name, UpstreamResult result)
+                                 {
+                                     FLASHFEED_CHECK_EQ(name, "AAPL");
+                                     if (results >= steps.size())
+                                     {
+                                         return true;
+                                     }
+                                     const Step &step = steps[results];
+                                     if (result.ok != step.expectOk || result.unchanged != step.expectUnchanged)
+                                     {
+                                         test::fail(__FILE__, __LINE__, "result " + std::to_string(results) + ": ok " +
+                                                                            std::to_string(result.ok) + ", unchanged " +
+                                                                            std::to_string(result.unchanged));
+                                     }
+                                     if (++results == steps.size())
+                                     {
+                                         running->stop();
+                                     }
+                                     return step.kept;
+                                 });
+        running = &scheduler;
+        scheduler.addJob("AAPL", "/query?symbol=AAPL", std::chrono::seconds(0));
+        scheduler.start();
+        ioc.run_for(std::chrono::seconds(20));
+
+        FLASHFEED_CHECK_EQ(results, steps.size());
+        FLASHFEED_CHECK_EQ(upstream.conditions().size(), steps.size());
+        for (std::size_t i = 0; i < steps.size() && i < upstream.conditions().size(); ++i)
+        {
+            if (upstream.conditions()[i].empty() == steps[i].expectConditional)
+            {
+                test::fail(__FILE__, __LINE__, "request " + std::to_string(i) + " sent If-None-Match: " + upstream.conditions()[i]);
+            }
+        }
+        FLASHFEED_CHECK_EQ(scheduler.stats().unchanged, 3u);
+        FLASHFEED_CHECK_EQ(scheduler.stats().notModified, 1u);
+    }
+}
+
+int main()
+{
+    failedAndRejectedResultsAreNotRepeats();
+    return test::finish("TestFetchScheduler");
+}
@@ -0,0 +1,196 @@
+#include "JsonBarParser.hpp"
+#include "TestCheck.hpp"
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// JsonBarParser must produce the same bars however the document is split:
+// at every single split point, one byte at a time, and in random pieces.
+// Also covers both layouts, skipped bars, API messages and malformed input.
+
+namespace
+{
+    const std::string SERIES_DOCUMENT = R"json({
+    "Meta Data": {
+        "1. Information": "Intraday (1min) \"open\", high, low, close prices and volume",
+        "2. Symbol": "AAPL",
+        "3. Last Refreshed": "2024-03-01 16:00:00",
+        "9. Escapes": "tab\t, slash \/, unicode é and a brace } in a string",
+        "10. Nested": [1, -2.5e3, true, false, null, {"a": []}]
+    },
+    "Time Series (1min)": {
+        "2024-03-01 16:00:00": {"1. open": "179.5500", "2. high": "179.7000", "3. low": "179.4000", "4. close": "179.6600", "5. volume": "3178214"},
+        "2024-03-01 15:59:00": {"1. open": "179.4000", "2. high": "179.6000", "3. low": "179.3500", "4. close": "179.5500", "5. volume": "1205413"},
+        "2024-03-01 15:58:00": {"1. open": "179.3000", "2. high": "179.4500", "3. low": "179.2000", "4. close": "179.4000", "5. volume": "954381"}
+    }
+})json";
+
+    const std::string ARRAY_DOCUMENT =
+        R"([{"timestamp": "2024-03-01T09:30:00", "open": 1.5, "high": 2e0, "low": 0.125, "close": "1.75", "volume": 1000},)"
+        R"( {"timestamp": "2024-03-01T09:31:00.250", "open": 1.75, "high": 1.8, "low": 1.7, "close": 1.78, "volume": 0}])";
+
+    struct Result
+    {
+        bool fed = true;
+        bool finished = false;
+        std::vector<MarketDataEntry> bars;
+        std::string apiMessage;
+        std::size_t skipped = 0;
+    };
+
+    Result parseInPieces(const std::string &document, const std::vector<std::size_t> &cuts)
+    {
+        Result result;
+        JsonBarParser parser(result.bars);
+        std::size_t from = 0;
+        for (std::size_t cut : cuts)
+        {
+            result.fed = parser.feed(std::string_view(document).substr(from, cut - from)) && result.fed;
+            from = cut;
+        }
+        result.fed = parser.feed(std::string_view(document).substr(from)) && result.fed;
+        result.finished = parser.finish();
+        result.apiMessage = parser.apiMessage();
+        result.skipped = parser.skippedBars();
+        return result;
+    }
+
+    Result parseWhole(const std::string &document)
+    {
+        return parseInPieces(document, {});
+    }
+
+    bool sameBars(const std::vector<MarketDataEntry> &a, const std::vector<MarketDataEntry> &b)
+    {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(MarketDataEntry)) == 0);
+    }
+
+    void checkSplitsAgree(const std::string &document)
+    {
+        const Result whole = parseWhole(document);
+        FLASHFEED_CHECK(whole.fed && whole.finished);
+
+        for (std::size_t cut = 1; cut < document.size(); ++cut)
+        {
+            const Result split = parseInPieces(document, {cut});
+            if (!split.fed || !split.finished || !sameBars(split.bars, whole.bars))
+            {
+                test::fail(__FILE__, __LINE__, "different result when split at byte " + std::to_string(cut));
+            }
+        }
+
+        std::vector<std::size_t> everyByte;
+        for (std::size_t cut = 1; cut < document.size(); ++cut)
+        {
+            everyByte.push_back(cut);
+        }
+        const Result bytes = parseInPieces(document, everyByte);
+        FLASHFEED_CHECK(bytes.fed && bytes.finished && sameBars(bytes.bars, whole.bars));
+
+        std::mt19937 random(17);
+        for (int round = 0; round < 200; ++round)
+        {
+            std::vector<std::size_t> cuts;
+            for (std::size_t cut = 1 + random() % 40; cut < document.size(); cut += 1 + random() % 40)
+            {
+                cuts.push_back(cut);
+            }
+            const Result pieces = parseInPieces(document, cuts);
+            FLASHFEED_CHECK(pieces.fed && pieces.finished && sameBars(pieces.bars, whole.bars));
+        }
+    }
+
+    void parsesTheTimeSeriesLayout()
+    {
+        const Result result = parseWhole(SERIES_DOCUMENT);
+        FLASHFEED_CHECK(result.fed && result.finished);
+        FLASHFEED_CHECK_EQ(result.bars.size(), 3u);
+        FLASHFEED_CHECK_EQ(result.skipped, 0u);
+        FLASHFEED_CHECK(result.apiMessage.empty());
+        if (result.bars.size() == 3)
+        {
+            // Document order, newest first as the API sends it
+            FLASHFEED_CHECK_EQ(result.bars[0].m_timestamp.toString(), "2024-03-01T16:00:00");
+            FLASHFEED_CHECK_EQ(result.bars[0].m_open, 179.55);
+            FLASHFEED_CHECK_EQ(result.bars[0].m_high, 179.7);
+            FLASHFEED_CHECK_EQ(result.bars[0].m_low, 179.4);
+            FLASHFEED_CHECK_EQ(result.bars[0].m_close, 179.66);
+            FLASHFEED_CHECK_EQ(result.bars[0].m_volume, 3178214.0);
+            FLASHFEED_CHECK_EQ(result.bars[2].m_timestamp.toString(), "2024-03-01T15:58:00");
+
+            std::vector<MarketDataEntry> sorted = result.bars;
+            JsonBarParser::sortByTimestamp(sorted);
+            FLASHFEED_CHECK(sorted.front().m_timestamp == result.bars.back().m_timestamp);
+        }
+    }
+
+    void parsesTheArrayLayout()
+    {
+        const Result result = parseWhole(ARRAY_DOCUMENT);
+        FLASHFEED_CHECK(result.fed && result.finished);
+        FLASHFEED_CHECK_EQ(result.bars.size(), 2u);
+        if (result.bars.size() == 2)
+        {
+            FLASHFEED_CHECK_EQ(result.bars[0].m_high, 2.0);
+            FLASHFEED_CHECK_EQ(result.bars[0].m_close, 1.75);
+            FLASHFEED_CHECK_EQ(result.bars[1].m_timestamp.toString(), "2024-03-01T09:31:00.250");
+        }
+    }
+
+    void skipsIncompleteBars()
+    {
+        const Result result = parseWhole(R"json({"Time Series (5min)": {
+            "2024-03-01 16:00:00": {"1. open": "1", "2. high": "2", "3. low": "0.5", "4. close": "1.5"},
+            "2024-03-01 15:55:00": {"1. open": "1", "2. high": "2", "3. low": "0.5", "4. close": "n/a", "5. volume": "10"},
+            "not a time": {"1. open": "1", "2. high": "2", "3. low": "0.5", "4. close": "1.5", "5. volume": "10"},
+            "2024-03-01 15:50:00": {"1. open": "1", "2. high": "2", "3. low": "0.5", "4. close": "1.5", "5. volume": "10"}
+        }})json");
+        FLASHFEED_CHECK(result.finished);
+        FLASHFEED_CHECK_EQ(result.bars.size(), 1u);
+        FLASHFEED_CHECK_EQ(result.skipped, 3u);
+    }
+
+    void keepsApiMessages()
+    {
+        const std::string note = R"({"Note": "Thank you for using Alpha Vantage! Our standard API rate limit is 25 requests per day."})";
+        const Result result = parseInPieces(note, {5, 12, 40});
+        FLASHFEED_CHECK(result.finished);
+        FLASHFEED_CHECK(result.bars.empty());
+        FLASHFEED_CHECK_EQ(result.apiMessage, "Thank you for using Alpha Vantage! Our standard API rate limit is 25 requests per day.");
+    }
+
+    void rejectsMalformedDocuments()
+    {
+        const char *const malformed[] = {
+            "",
+            "{",
+            R"json({"Time Series (1min)": {"2024-03-01 16:00:00": {"1. open": "1")json",
+            R"({"a": 1,})",
+            R"({"a" 1})",
+            R"([1, 2] [3])",
+            R"({"a": tru})",
+            R"(})",
+        };
+        for (const char *text : malformed)
+        {
+            const Result result = parseWhole(text);
+            if (result.fed && result.finished)
+            {
+                test::fail(__FILE__, __LINE__, std::string("accepted ") + text);
+            }
+        }
+    }
+}
+
+int main()
+{
+    parsesTheTimeSeriesLayout();
+    parsesTheArrayLayout();
+    checkSplitsAgree(SERIES_DOCUMENT);
+    checkSplitsAgree(ARRAY_DOCUMENT);
+    skipsIncompleteBars();
+    keepsApiMessages();
+    rejectsMalformedDocuments();
+    return test::finish("TestJsonBarParser");
+}
@@ -0,0 +1,183 @@
+#include "LatencyHistogram.hpp"
+#include "TestCheck.hpp"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+// LatencyHistogram buckets and LatencySnapshot percentiles: buckets tile the
+// range within 1/SUB_BUCKET_COUNT, percentiles are within that of the exact
+// value, and adding or subtracting snapshots matches one histogram of the
+// same samples.
+
+namespace
+{
+    const double PERCENTILES[] = {0, 1, 10, 25, 50, 75, 90, 99, 99.9, 99.99, 100};
+
+    // Spread over every magnitude, from single nanoseconds to seconds
+    std::vector<std::uint64_t> samples(std::size_t count, unsigned seed)
+    {
+        std::mt19937_64 random(seed);
+        std::uniform_real_distribution<double> exponent(0.0, 31.0);
+        std::vector<std::uint64_t> out(count);
+        for (auto &value : out)
+        {
+            value = static_cast<std::uint64_t>(std::exp2(exponent(random)));
+        }
+        return out;
+    }
+
+    // The sample a percentile should land on, with the rank rule LatencySnapshot uses
+    std::uint64_t exactPercentile(std::vector<std::uint64_t> sorted, double percent)
+    {
+        std::sort(sorted.begin(), sorted.end());
+        const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(percent / 100.0 * sorted.size())));
+        return sorted[rank - 1];
+    }
+
+    void sameSnapshot(const LatencySnapshot &actual, const LatencySnapshot &expected)
+    {
+        FLASHFEED_CHECK_EQ(actual.count(), expected.count());
+        FLASHFEED_CHECK_EQ(actual.max(), expected.max());
+        FLASHFEED_CHECK_EQ(actual.mean(), expected.mean());
+        for (double percent : PERCENTILES)
+        {
+            FLASHFEED_CHECK_EQ(actual.percentile(percent), expected.percentile(percent));
+        }
+    }
+
+    void bucketsTileTheRange()
+    {
+        for (std::uint64_t nanos = 0; nanos < LatencyHistogram::SUB_BUCKET_COUNT; ++nanos)
+        {
+            FLASHFEED_CHECK_EQ(LatencyHistogram::bucketFor(nanos), nanos);
+        }
+        for (std::size_t bucket = 0; bucket + 1 < LatencyHistogram::BUCKET_COUNT; ++bucket)
+        {
+            const std::uint64_t highest = LatencyHistogram::highestEquivalent(bucket);
+            if (LatencyHistogram::bucketFor(highest) != bucket || LatencyHistogram::bucketFor(highest + 1) != bucket + 1)
+            {
+                test::fail(__FILE__, __LINE__, "bucket " + std::to_string(bucket) + " does not end where the next begins");
+            }
+            // A bucket is never wider than 1/SUB_BUCKET_COUNT of the values in it
+            const std::uint64_t lowest = bucket ? LatencyHistogram::highestEquivalent(bucket - 1) + 1 : 0;
+            FLASHFEED_CHECK((highest - lowest) * LatencyHistogram::SUB_BUCKET_COUNT <= std::max<std::uint64_t>(lowest, 1));
+        }
+        FLASHFEED_CHECK_EQ(LatencyHistogram::highestEquivalent(LatencyHistogram::BUCKET_COUNT - 1), LatencyHistogram::MAX_TRACKED);
+        FLASHFEED_CHECK_EQ(LatencyHistogram::bucketFor(UINT64_MAX), LatencyHistogram::BUCKET_COUNT - 1);
+    }
+
+    void percentilesAreWithinBucketPrecision()
+    {
+        const std::vector<std::uint64_t> values = samples(100000, 25);
+        auto histogram = std::make_unique<LatencyHistogram>();
+        for (std::uint64_t value : values)
+        {
+            histogram->record(value);
+        }
+        LatencySnapshot snapshot;
+        snapshot.add(*histogram);
+        FLASHFEED_CHECK_EQ(snapshot.count(), values.size());
+        FLASHFEED_CHECK_EQ(snapshot.max(), *std::max_element(values.begin(), values.end()));
+
+        for (double percent : PERCENTILES)
+        {
+            // Reported as the top of the sample's bucket: never below it, and at most 1.6% above
+            const std::uint64_t exact = exactPercentile(values, percent);
+            const std::uint64_t reported = snapshot.percentile(percent);
+            if (reported < exact || (reported - exact) * LatencyHistogram::SUB_BUCKET_COUNT > exact)
+            {
+                test::fail(__FILE__, __LINE__, "p" + std::to_string(percent) + " is " + std::to_string(reported) +
+                                                   ", exact " + std::to_string(exact));
+            }
+        }
+        FLASHFEED_CHECK_EQ(snapshot.percentile(100), snapshot.max());
+
+        LatencySnapshot empty;
+        FLASHFEED_CHECK_EQ(empty.percentile(50), 0u);
+        FLASHFEED_CHECK_EQ(empty.mean(), 0.0);
+    }
+
+    void valuesPastTheRangeKeepTheirMaximum()
+    {
+        auto histogram = std::make_unique<LatencyHistogram>();
+        histogram->record(5);
+        histogram->record(LatencyHistogram::MAX_TRACKED * 10);
+        LatencySnapshot snapshot;
+        snapshot.add(*histogram);
+        FLASHFEED_CHECK_EQ(snapshot.max(), LatencyHistogram::MAX_TRACKED * 10);
+        FLASHFEED_CHECK_EQ(snapshot.percentile(50), 5u);
+        FLASHFEED_CHECK_EQ(snapshot.percentile(100), LatencyHistogram::MAX_TRACKED);
+    }
+
+    void addedSnapshotsMatchOneHistogram()
+    {
+        const std::vector<std::uint64_t> values = samples(50000, 7);
+        auto all = std::make_unique<LatencyHistogram>();
+        auto first = std::make_unique<LatencyHistogram>();
+        auto second = std::make_unique<LatencyHistogram>();
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            all->record(values[i]);
+            (i % 3 ? first : second)->record(values[i]);
+        }
+
+        LatencySnapshot expected;
+        expected.add(*all);
+        LatencySnapshot merged;
+        merged.add(*first);
+        merged.add(*second);
+        sameSnapshot(merged, expected);
+    }
+
+    void subtractLeavesTheLaterSamples()
+    {
+        const std::vector<std::uint64_t> before = samples(20000, 11);
+        const std::vector<std::uint64_t> after = samples(5000, 13);
+        auto histogram = std::make_unique<LatencyHistogram>();
+        auto later = std::make_unique<LatencyHistogram>();
+        for (std::uint64_t value : before)
+        {
+            histogram->record(value);
+        }
+        LatencySnapshot earlier;
+        earlier.add(*histogram);
+        for (std::uint64_t value : after)
+        {
+            histogram->record(value);
+            later->record(value);
+        }
+
+        LatencySnapshot interval;
+        interval.add(*histogram);
+        interval.subtract(earlier);
+        LatencySnapshot expected;
+        expected.add(*later);
+
+        FLASHFEED_CHECK_EQ(interval.count(), expected.count());
+        FLASHFEED_CHECK_EQ(interval.mean(), expected.mean());
+        for (double percent : {0.0, 1.0, 50.0, 90.0, 99.0, 99.9})
+        {
+            FLASHFEED_CHECK_EQ(interval.percentile(percent), expected.percentile(percent));
+        }
+        // The interval's maximum is only known to its bucket, capped by the running maximum
+        FLASHFEED_CHECK(interval.max() >= expected.max());
+        FLASHFEED_CHECK_EQ(interval.max(), std::min(LatencyHistogram::highestEquivalent(LatencyHistogram::bucketFor(expected.max())),
+                                                    std::max(expected.max(), *std::max_element(before.begin(), before.end()))));
+
+        interval.subtract(interval);
+        FLASHFEED_CHECK_EQ(interval.count(), 0u);
+        FLASHFEED_CHECK_EQ(interval.max(), 0u);
+    }
+}
+
+int main()
+{
+    bucketsTileTheRange();
+    percentilesAreWithinBucketPrecision();
+    valuesPastTheRangeKeepTheirMaximum();
+    addedSnapshotsMatchOneHistogram();
+    subtractLeavesTheLaterSamples();
+    return test::finish("TestLatencyHistogram");
+}
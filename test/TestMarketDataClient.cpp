@@ -1,4 +1,5 @@
 #include <iostream>
+#include <utility>
 #include <boost/asio.hpp>
 
 using namespace boost::asio;
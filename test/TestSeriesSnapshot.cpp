@@ -0,0 +1,150 @@
+#include "SeriesSnapshot.hpp"
+#include "TestCheck.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// SeriesSnapshot write -> read round trips, and that a corrupted, truncated
+// or extended file is rejected instead of loaded.
+
+namespace
+{
+    MarketDataEntry bar(std::int64_t minute, double close)
+    {
+        return MarketDataEntry(Timestamp(minute * 60 * 1000000000LL), close - 1, close + 1, close - 2, close, 100);
+    }
+
+    std::filesystem::path scratchDirectory()
+    {
+        const std::filesystem::path directory =
+            std::filesystem::temp_directory_path() / ("flashfeed_snapshot_test_" + std::to_string(::getpid()));
+        std::filesystem::create_directories(directory);
+        return directory;
+    }
+
+    std::string readBytes(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void writeBytes(const std::string &path, const std::string &bytes)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    bool sameColumns(const ColumnarSeries &a, const ColumnarSeries &b)
+    {
+        auto same = [](auto x, auto y)
+        { return x.size() == y.size() && (x.empty() || std::memcmp(x.data(), y.data(), x.size() * sizeof(x[0])) == 0); };
+        return same(a.timestamps(), b.timestamps()) && same(a.opens(), b.opens()) && same(a.highs(), b.highs()) &&
+               same(a.lows(), b.lows()) && same(a.closes(), b.closes()) && same(a.volumes(), b.volumes()) &&
+               same(a.rowSequences(), b.rowSequences());
+    }
+
+    // Three versions, so rows carry different sequences
+    ColumnarSeries sampleSeries()
+    {
+        ColumnarSeries empty;
+        ColumnarSeries v1;
+        ColumnarSeries v2;
+        ColumnarSeries v3;
+        ColumnarSeries::merge(empty, {bar(1, 10), bar(2, 20), bar(3, 30)}, v1);
+        ColumnarSeries::merge(v1, {bar(2, 22)}, v2);
+        ColumnarSeries::merge(v2, {bar(4, 40), bar(5, 50)}, v3);
+        return v3;
+    }
+
+    void roundTripKeepsEverything(const std::filesystem::path &directory)
+    {
+        const ColumnarSeries original = sampleSeries();
+        const std::string path = SeriesSnapshot::pathFor(directory.string(), "BRK.B");
+        FLASHFEED_CHECK_EQ(path, (directory / "BRK.B.ffs").string());
+
+        std::string error;
+        FLASHFEED_CHECK(SeriesSnapshot::write(path, "BRK.B", original, error));
+        FLASHFEED_CHECK(!std::filesystem::exists(path + ".tmp"));
+
+        std::string symbol;
+        ColumnarSeries loaded;
+        FLASHFEED_CHECK(SeriesSnapshot::read(path, symbol, loaded, error));
+        FLASHFEED_CHECK_EQ(symbol, "BRK.B");
+        FLASHFEED_CHECK_EQ(loaded.sequence(), original.sequence());
+        FLASHFEED_CHECK(sameColumns(loaded, original));
+        FLASHFEED_CHECK_EQ(loaded.changedSince(1).size(), 3u);
+        FLASHFEED_CHECK_EQ(loaded.changedSince(2).size(), 2u);
+
+        // A loaded series merges like the one it was written from
+        ColumnarSeries next;
+        const SeriesUpdate update = ColumnarSeries::merge(loaded, {bar(6, 60)}, next);
+        FLASHFEED_CHECK_EQ(update.previousSequence, original.sequence());
+        FLASHFEED_CHECK_EQ(next.size(), 6u);
+
+        // An empty series round trips too
+        FLASHFEED_CHECK(SeriesSnapshot::write(path, "EMPTY", ColumnarSeries(), error));
+        FLASHFEED_CHECK(SeriesSnapshot::read(path, symbol, loaded, error));
+        FLASHFEED_CHECK_EQ(symbol, "EMPTY");
+        FLASHFEED_CHECK(loaded.empty());
+    }
+
+    void corruptFilesAreRejected(const std::filesystem::path &directory)
+    {
+        const std::string path = (directory / "AAPL.ffs").string();
+        std::string error;
+        FLASHFEED_CHECK(SeriesSnapshot::write(path, "AAPL", sampleSeries(), error));
+        const std::string good = readBytes(path);
+        FLASHFEED_CHECK_EQ(good.size() % 64, 0u);
+
+        // A single flipped bit anywhere, header or payload, fails a checksum or a sanity check
+        for (std::size_t offset = 0; offset < good.size(); ++offset)
+        {
+            std::string bad = good;
+            bad[offset] = static_cast<char>(bad[offset] ^ 0x10);
+            writeBytes(path, bad);
+            std::string symbol;
+            ColumnarSeries loaded;
+            if (SeriesSnapshot::read(path, symbol, loaded, error))
+            {
+                test::fail(__FILE__, __LINE__, "accepted a file with byte " + std::to_string(offset) + " changed");
+            }
+        }
+
+        // Cut short or with bytes after the payload, the size no longer matches the header
+        for (std::size_t size : {std::size_t(0), std::size_t(10), SeriesSnapshot::HEADER_SIZE, good.size() - 64,
+                                 good.size() - 1})
+        {
+            writeBytes(path, good.substr(0, size));
+            std::string symbol;
+            ColumnarSeries loaded;
+            if (SeriesSnapshot::read(path, symbol, loaded, error))
+            {
+                test::fail(__FILE__, __LINE__, "accepted a file truncated to " + std::to_string(size) + " bytes");
+            }
+        }
+        writeBytes(path, good + std::string(64, '\0'));
+        std::string symbol;
+        ColumnarSeries loaded;
+        FLASHFEED_CHECK(!SeriesSnapshot::read(path, symbol, loaded, error));
+        FLASHFEED_CHECK_EQ(error, "size does not match the header");
+
+        writeBytes(path, good);
+        FLASHFEED_CHECK(SeriesSnapshot::read(path, symbol, loaded, error));
+
+        FLASHFEED_CHECK(!SeriesSnapshot::read((directory / "MISSING.ffs").string(), symbol, loaded, error));
+        FLASHFEED_CHECK(!SeriesSnapshot::write((directory / "no" / "such" / "dir.ffs").string(), "X", sampleSeries(), error));
+    }
+}
+
+int main()
+{
+    const std::filesystem::path directory = scratchDirectory();
+    roundTripKeepsEverything(directory);
+    corruptFilesAreRejected(directory);
+    std::filesystem::remove_all(directory);
+    return test::finish("TestSeriesSnapshot");
+}
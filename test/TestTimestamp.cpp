@@ -0,0 +1,109 @@
+#include "TestCheck.hpp"
+#include "Timestamp.hpp"
+#include <random>
+#include <string>
+
+// Timestamp parsing and formatting: known instants, both separators, the
+// shortest exact fraction, malformed input, and format -> parse round trips.
+
+namespace
+{
+    constexpr std::int64_t NANOS_PER_SECOND = 1000000000;
+
+    std::int64_t parsed(const std::string &text)
+    {
+        Timestamp timestamp(-42);
+        if (!Timestamp::parse(text, timestamp))
+        {
+            test::fail(__FILE__, __LINE__, "could not parse \"" + text + "\"");
+        }
+        return timestamp.m_nanos;
+    }
+
+    void parsesKnownInstants()
+    {
+        FLASHFEED_CHECK_EQ(parsed("1970-01-01T00:00:00"), 0);
+        FLASHFEED_CHECK_EQ(parsed("2024-02-29 16:00:00"), 1709222400 * NANOS_PER_SECOND);
+        FLASHFEED_CHECK_EQ(parsed("2024-02-29T16:00:00"), 1709222400 * NANOS_PER_SECOND);
+        FLASHFEED_CHECK_EQ(parsed("1999-12-31 23:59:59"), 946684799 * NANOS_PER_SECOND);
+        FLASHFEED_CHECK_EQ(parsed("1969-12-31T23:59:59.999999999"), -1);
+        FLASHFEED_CHECK_EQ(parsed("1970-01-01T00:00:00.5"), NANOS_PER_SECOND / 2);
+        FLASHFEED_CHECK_EQ(parsed("1970-01-01T00:00:00.000001"), 1000);
+    }
+
+    void formatsWithSeparatorAndShortestFraction()
+    {
+        const Timestamp close(1709222400 * NANOS_PER_SECOND);
+        FLASHFEED_CHECK_EQ(close.toString(), "2024-02-29T16:00:00");
+        FLASHFEED_CHECK_EQ(close.toString(Timestamp::EDGE_SEPARATOR), "2024-02-29 16:00:00");
+        FLASHFEED_CHECK_EQ(Timestamp(NANOS_PER_SECOND / 2).toString(), "1970-01-01T00:00:00.500");
+        FLASHFEED_CHECK_EQ(Timestamp(1000).toString(), "1970-01-01T00:00:00.000001");
+        FLASHFEED_CHECK_EQ(Timestamp(1).toString(), "1970-01-01T00:00:00.000000001");
+        FLASHFEED_CHECK_EQ(Timestamp(-1).toString(), "1969-12-31T23:59:59.999999999");
+        FLASHFEED_CHECK_EQ(Timestamp(-1).toString().size(), Timestamp::MAX_FORMATTED_LENGTH);
+    }
+
+    void rejectsMalformedText()
+    {
+        const char *const malformed[] = {
+            "",
+            "2024-02-29",
+            "2024-02-29X16:00:00",
+            "2024/02/29 16:00:00",
+            "2023-02-29 16:00:00", // Not a leap year
+            "2024-13-01 00:00:00",
+            "2024-00-01 00:00:00",
+            "2024-04-31 00:00:00",
+            "2024-01-01 24:00:00",
+            "2024-01-01 00:60:00",
+            "2024-01-01 00:00:60",
+            "2024-01-01 00:00:00.",
+            "2024-01-01 00:00:00.1234567890",
+            "2024-01-01 00:00:00,5",
+            "2024-01-01 00:00:0a",
+            "2024-01-01 00:00:00Z",
+        };
+        for (const char *text : malformed)
+        {
+            Timestamp timestamp;
+            if (Timestamp::parse(text, timestamp))
+            {
+                test::fail(__FILE__, __LINE__, std::string("accepted \"") + text + "\"");
+            }
+        }
+    }
+
+    void roundTripsThroughText()
+    {
+        // 1900-01-01 to 2100-01-01, at second, millisecond, microsecond and nanosecond precision
+        const std::int64_t from = -2208988800LL * NANOS_PER_SECOND;
+        const std::int64_t to = 4102444800LL * NANOS_PER_SECOND;
+        const std::int64_t precisions[] = {NANOS_PER_SECOND, 1000000, 1000, 1};
+        std::mt19937_64 random(3);
+        for (int i = 0; i < 20000; ++i)
+        {
+            const std::int64_t precision = precisions[i % 4];
+            const std::int64_t nanos = (from + static_cast<std::int64_t>(random() % static_cast<std::uint64_t>(to - from))) /
+                                       precision * precision;
+            const Timestamp original(nanos);
+            for (char separator : {'T', Timestamp::EDGE_SEPARATOR})
+            {
+                const std::string text = original.toString(separator);
+                Timestamp back;
+                if (!Timestamp::parse(text, back) || back != original)
+                {
+                    test::fail(__FILE__, __LINE__, "\"" + text + "\" does not parse back to " + std::to_string(nanos));
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    parsesKnownInstants();
+    formatsWithSeparatorAndShortestFraction();
+    rejectsMalformedText();
+    roundTripsThroughText();
+    return test::finish("TestTimestamp");
+}
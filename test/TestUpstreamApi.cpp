@@ -0,0 +1,158 @@
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast.hpp>
+#include <boost/beast/ssl.hpp>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Local stand-in for the Alpha Vantage API, for running the server's fetcher
+// without network access. Answers every GET with a small intraday series for
+// the requested symbol after an artificial delay, and prints how many requests
+// were in flight at once. Connections are kept alive between requests; with a
+// per-connection limit the stand-in drops a connection after that many
+// responses without announcing it, as a server timing out idle clients would.
+// The series only changes once a minute; responses carry an ETag, and a
+// request whose If-None-Match still matches gets a 304.
+//
+// Usage: TestUpstreamApi [port] [delay ms] [requests per connection, 0 = no limit] [cert.pem key.pem]
+// Point the server at it with "api_host": "127.0.0.1", "api_port": "<port>",
+// and "api_use_tls": false unless a certificate and key were given (any
+// self-signed pair will do). A delay above fetch_timeout_seconds exercises timeouts.
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace ssl = net::ssl;
+using tcp = net::ip::tcp;
+
+std::atomic<int> inFlight{0};
+std::atomic<int> maxInFlight{0};
+
+std::string symbolFromTarget(const std::string &target)
+{
+    auto start = target.find("symbol=");
+    if (start == std::string::npos) {
+        return "UNKNOWN";
+    }
+    start += 7;
+    return target.substr(start, target.find('&', start) - start);
+}
+
+// Five one-minute bars ending at the current minute, so every fetch adds a bar
+std::string intradayJson(const std::string &symbol)
+{
+    std::time_t now = std::time(nullptr);
+    now -= now % 60;
+    std::ostringstream out;
+    out << "{\"Meta Data\": {\"2. Symbol\": \"" << symbol << "\"}, \"Time Series (1min)\": {";
+    for (int i = 0; i < 5; ++i) {
+        std::time_t bar = now - i * 60;
+        std::tm tm = *std::gmtime(&bar);
+        double price = 100.0 + (bar / 60) % 50;
+        out << (i ? ", " : "") << "\"" << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << "\": {"
+            << "\"1. open\": \"" << price << "\", \"2. high\": \"" << price + 1 << "\", "
+            << "\"3. low\": \"" << price - 1 << "\", \"4. close\": \"" << price + 0.5 << "\", "
+            << "\"5. volume\": \"" << 1000 + i << "\"}";
+    }
+    out << "}}";
+    return out.str();
+}
+
+template <class Stream>
+void serveRequests(Stream &stream, int delayMs, int perConnection) {
+    beast::flat_buffer buffer;
+    for (int served = 0; perConnection == 0 || served < perConnection; ++served) {
+        http::request<http::string_body> req;
+        beast::error_code ec;
+        http::read(stream, buffer, req, ec);
+        if (ec) {
+            return; // Closed by the client
+        }
+
+        int current = ++inFlight;
+        int seen = maxInFlight.load();
+        while (current > seen && !maxInFlight.compare_exchange_weak(seen, current)) {
+        }
+        std::string symbol = symbolFromTarget(std::string(req.target()));
+        std::cout << "GET " << symbol << " (" << current << " in flight, max " << maxInFlight << ")" << std::endl;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+
+        std::string body = intradayJson(symbol);
+        std::string etag = "\"" + std::to_string(std::hash<std::string>()(body)) + "\"";
+        bool notModified = req[http::field::if_none_match] == etag;
+        std::cout << (notModified ? "  304 " : "  200 ") << symbol << std::endl;
+
+        http::response<http::string_body> res{notModified ? http::status::not_modified : http::status::ok, req.version()};
+        res.set(http::field::etag, etag);
+        res.keep_alive(req.keep_alive());
+        if (!notModified) {
+            res.set(http::field::content_type, "application/json");
+            res.body() = std::move(body);
+        }
+        res.prepare_payload();
+        http::write(stream, res, ec);
+        --inFlight;
+        if (ec || !req.keep_alive()) {
+            return;
+        }
+    }
+}
+
+void serve(tcp::socket socket, int delayMs, int perConnection, ssl::context *tls) {
+    try {
+        if (!tls) {
+            serveRequests(socket, delayMs, perConnection);
+            beast::error_code ec;
+            socket.shutdown(tcp::socket::shutdown_send, ec);
+            return;
+        }
+        beast::ssl_stream<tcp::socket> stream(std::move(socket), *tls);
+        stream.handshake(ssl::stream_base::server);
+        std::cout << (SSL_session_reused(stream.native_handle()) ? "Resumed" : "Full") << " TLS handshake" << std::endl;
+        serveRequests(stream, delayMs, perConnection);
+        beast::error_code ec;
+        stream.shutdown(ec);
+    } catch (std::exception &e) {
+        std::cerr << "Connection error: " << e.what() << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned short port = static_cast<unsigned short>(argc > 1 ? std::stoi(argv[1]) : 8443);
+    int delayMs = argc > 2 ? std::stoi(argv[2]) : 500;
+
+    int perConnection = argc > 3 ? std::stoi(argv[3]) : 0;
+
+    std::unique_ptr<ssl::context> tls;
+    if (argc > 5) {
+        tls = std::make_unique<ssl::context>(ssl::context::tlsv12_server);
+        tls->use_certificate_chain_file(argv[4]);
+        tls->use_private_key_file(argv[5], ssl::context::pem);
+    }
+
+    try {
+        net::io_context io;
+        tcp::acceptor acceptor(io, tcp::endpoint(tcp::v4(), port));
+        std::cout << "Stand-in API listening on port " << port << (tls ? " (TLS)" : "") << ", " << delayMs << " ms per request" << std::endl;
+
+        while (true) {
+            tcp::socket socket(io);
+            acceptor.accept(socket);
+            std::thread(serve, std::move(socket), delayMs, perConnection, tls.get()).detach();
+        }
+    } catch (std::exception &e) {
+        std::cerr << "Server error: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
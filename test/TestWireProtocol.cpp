@@ -0,0 +1,279 @@
+#include "TestCheck.hpp"
+#include "TimeSeriesStore.hpp"
+#include "WireProtocol.hpp"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Text and binary frame headers as the server writes them and the client
+// parses them, the packed binary records, and applyDelta merging UPDATE rows
+// into a client's copy, including the bars a row-limited series drops.
+
+namespace
+{
+    MarketDataEntry bar(std::int64_t minute, double close)
+    {
+        return MarketDataEntry(Timestamp(minute * 60 * 1000000000LL), close - 1, close + 1, close - 2, close, 100);
+    }
+
+    // Header line as read from the socket, without its '\n'
+    std::string line(const std::string &header)
+    {
+        FLASHFEED_CHECK(!header.empty() && header.back() == '\n');
+        return header.substr(0, header.size() - 1);
+    }
+
+    std::vector<double> closes(const std::vector<MarketDataEntry> &rows)
+    {
+        std::vector<double> out;
+        for (const auto &row : rows)
+        {
+            out.push_back(row.m_close);
+        }
+        return out;
+    }
+
+    void textHeadersRoundTrip()
+    {
+        WireProtocol::FrameHeader header;
+        FLASHFEED_CHECK(WireProtocol::parseFrameHeader(line(WireProtocol::makeDataHeader(1234)), header));
+        FLASHFEED_CHECK(header.type == WireProtocol::FrameType::Data);
+        FLASHFEED_CHECK_EQ(header.payloadSize, 1234u);
+
+        FLASHFEED_CHECK(WireProtocol::parseFrameHeader(line(WireProtocol::makeSnapshotHeader("AAPL", 7, 99)), header));
+        FLASHFEED_CHECK(header.type == WireProtocol::FrameType::Snapshot);
+        FLASHFEED_CHECK_EQ(header.symbol, "AAPL");
+        FLASHFEED_CHECK_EQ(header.sequence, 7u);
+        FLASHFEED_CHECK_EQ(header.payloadSize, 99u);
+
+        FLASHFEED_CHECK(WireProtocol::parseFrameHeader(line(WireProtocol::makeUpdateHeader("BRK.B", 18446744073709551614ULL,
+                                                                                            18446744073709551615ULL,
+                                                                                            Timestamp(-5), 0)),
+                                                       header));
+        FLASHFEED_CHECK(header.type == WireProtocol::FrameType::Update);
+        FLASHFEED_CHECK_EQ(header.symbol, "BRK.B");
+        FLASHFEED_CHECK_EQ(header.previousSequence, 18446744073709551614ULL);
+        FLASHFEED_CHECK_EQ(header.sequence, 18446744073709551615ULL);
+        FLASHFEED_CHECK_EQ(header.firstTimestamp.m_nanos, -5);
+        FLASHFEED_CHECK_EQ(header.payloadSize, 0u);
+
+        FLASHFEED_CHECK(WireProtocol::parseFrameHeader(line(WireProtocol::makeStatsHeader(42)), header));
+        FLASHFEED_CHECK(header.type == WireProtocol::FrameType::Stats);
+        FLASHFEED_CHECK_EQ(header.payloadSize, 42u);
+
+        // CRLF line endings are tolerated
+        FLASHFEED_CHECK(WireProtocol::parseFrameHeader("UPDATE:MSFT:3:4:60000000000:280\r", header));
+        FLASHFEED_CHECK_EQ(header.firstTimestamp.m_nanos, 60000000000);
+        FLASHFEED_CHECK_EQ(header.payloadSize, 280u);
+
+        FLASHFEED_CHECK(WireProtocol::parseFrameHeader("HELLO:DELTA BINARY", header));
+        FLASHFEED_CHECK(header.type == WireProtocol::FrameType::Hello);
+        FLASHFEED_CHECK_EQ(header.text, "DELTA BINARY");
+
+        FLASHFEED_CHECK(WireProtocol::parseFrameHeader("ERROR:Unknown symbol: XYZ", header));
+        FLASHFEED_CHECK(header.type == WireProtocol::FrameType::Error);
+        FLASHFEED_CHECK_EQ(header.text, "Unknown symbol: XYZ");
+    }
+
+    void malformedTextHeadersAreRejected()
+    {
+        const char *const malformed[] = {
+            "",
+            "DATA_SIZE:",
+            "DATA_SIZE:12x",
+            "DATA_SIZE:-1",
+            "SNAPSHOT:AAPL:7",
+            "SNAPSHOT::7:99",
+            "SNAPSHOT:AAPL:7:99:1",
+            "UPDATE:AAPL:1:2:3",
+            "UPDATE:AAPL:1:2:3:4:5",
+            "UPDATE:AAPL:one:2:3:4",
+            "UPDATE:AAPL:1:2:1e9:4",
+            "UPDATE:AAPL:1:2:3:18446744073709551616999",
+            "STATS:",
+            "NEWS:AAPL:1",
+            "data_size:10",
+        };
+        for (const char *text : malformed)
+        {
+            WireProtocol::FrameHeader header;
+            if (WireProtocol::parseFrameHeader(text, header))
+            {
+                test::fail(__FILE__, __LINE__, std::string("accepted \"") + text + "\"");
+            }
+        }
+    }
+
+    std::uint64_t littleEndianAt(const std::string &bytes, std::size_t offset, std::size_t size)
+    {
+        std::uint64_t value = 0;
+        for (std::size_t i = size; i-- > 0;)
+        {
+            value = (value << 8) | static_cast<std::uint8_t>(bytes[offset + i]);
+        }
+        return value;
+    }
+
+    bool sameBits(const MarketDataEntry &a, const MarketDataEntry &b)
+    {
+        return std::memcmp(&a, &b, sizeof(MarketDataEntry)) == 0;
+    }
+
+    void binaryHeaderLayout()
+    {
+        const std::string bytes = WireProtocol::makeBinaryHeader(WireProtocol::FrameType::Update, 0x01020304, 3,
+                                                                 0x1112131415161718ULL, 0x2122232425262728ULL, 144,
+                                                                 Timestamp(-2));
+        FLASHFEED_CHECK_EQ(bytes.size(), WireProtocol::BINARY_HEADER_SIZE);
+        FLASHFEED_CHECK_EQ(static_cast<std::uint8_t>(bytes[0]), WireProtocol::BINARY_MAGIC);
+        FLASHFEED_CHECK_EQ(static_cast<int>(bytes[1]), static_cast<int>(WireProtocol::FrameType::Update));
+        FLASHFEED_CHECK_EQ(littleEndianAt(bytes, 2, 2), 0u);
+        FLASHFEED_CHECK_EQ(littleEndianAt(bytes, 4, 4), 0x01020304u);
+        FLASHFEED_CHECK_EQ(littleEndianAt(bytes, 8, 4), 3u);
+        FLASHFEED_CHECK_EQ(littleEndianAt(bytes, 12, 4), 144u);
+        FLASHFEED_CHECK_EQ(littleEndianAt(bytes, 16, 8), 0x1112131415161718ULL);
+        FLASHFEED_CHECK_EQ(littleEndianAt(bytes, 24, 8), 0x2122232425262728ULL);
+        FLASHFEED_CHECK_EQ(littleEndianAt(bytes, 32, 8), 0xFFFFFFFFFFFFFFFEULL);
+
+        WireProtocol::FrameHeader header;
+        FLASHFEED_CHECK(WireProtocol::parseBinaryHeader(bytes.data(), header));
+        FLASHFEED_CHECK(header.type == WireProtocol::FrameType::Update);
+        FLASHFEED_CHECK_EQ(header.symbolId, 0x01020304u);
+        FLASHFEED_CHECK_EQ(header.count, 3u);
+        FLASHFEED_CHECK_EQ(header.payloadSize, 144u);
+        FLASHFEED_CHECK_EQ(header.previousSequence, 0x1112131415161718ULL);
+        FLASHFEED_CHECK_EQ(header.sequence, 0x2122232425262728ULL);
+        FLASHFEED_CHECK_EQ(header.firstTimestamp.m_nanos, -2);
+    }
+
+    void badBinaryHeadersAreRejected()
+    {
+        WireProtocol::FrameHeader header;
+        std::string bytes = WireProtocol::makeBinaryHeader(WireProtocol::FrameType::Data, 1, 0, 0, 0, 0);
+        bytes[0] = 'D'; // A text header where a binary one was expected
+        FLASHFEED_CHECK(!WireProtocol::parseBinaryHeader(bytes.data(), header));
+
+        bytes = WireProtocol::makeBinaryHeader(WireProtocol::FrameType::Hello, 1, 0, 0, 0, 0);
+        FLASHFEED_CHECK(!WireProtocol::parseBinaryHeader(bytes.data(), header));
+        bytes[1] = 99;
+        FLASHFEED_CHECK(!WireProtocol::parseBinaryHeader(bytes.data(), header));
+    }
+
+    void binaryRecordsRoundTrip()
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        std::vector<MarketDataEntry> rows = {bar(1, 10), bar(2, nan), bar(3, -0.0)};
+        rows.push_back(MarketDataEntry(Timestamp(-1), 1e-300, 1e300, -1, 0, 1ULL << 53));
+
+        std::string payload;
+        WireProtocol::encodeBinaryRecords(rows, payload);
+        FLASHFEED_CHECK_EQ(payload.size(), rows.size() * WireProtocol::BINARY_RECORD_SIZE);
+
+        // The bulk encoder writes the same bytes as the per-record one
+        std::string oneByOne;
+        for (const auto &row : rows)
+        {
+            WireProtocol::appendBinaryRecord(oneByOne, row);
+        }
+        FLASHFEED_CHECK(payload == oneByOne);
+        FLASHFEED_CHECK_EQ(littleEndianAt(payload, 0, 8), static_cast<std::uint64_t>(rows[0].m_timestamp.m_nanos));
+
+        // Decoding appends, and every field comes back bit for bit
+        std::vector<MarketDataEntry> decoded = {bar(0, 1)};
+        FLASHFEED_CHECK(WireProtocol::decodeBinaryRecords(payload, decoded));
+        FLASHFEED_CHECK_EQ(decoded.size(), rows.size() + 1);
+        for (std::size_t i = 0; i < rows.size() && i + 1 < decoded.size(); ++i)
+        {
+            FLASHFEED_CHECK(sameBits(decoded[i + 1], rows[i]));
+        }
+
+        std::vector<MarketDataEntry> partial;
+        FLASHFEED_CHECK(!WireProtocol::decodeBinaryRecords(std::string_view(payload).substr(0, payload.size() - 1), partial));
+        FLASHFEED_CHECK(partial.empty());
+        FLASHFEED_CHECK(WireProtocol::decodeBinaryRecords(std::string_view(), partial));
+        FLASHFEED_CHECK(partial.empty());
+    }
+
+    void applyDeltaMergesByTimestamp()
+    {
+        std::vector<MarketDataEntry> local;
+        WireProtocol::applyDelta(local, {bar(1, 10), bar(3, 30)}, bar(1, 0).m_timestamp);
+        FLASHFEED_CHECK(closes(local) == std::vector<double>({10, 30}));
+
+        // Tail append, replacement of an existing bar, and an insert before the tail
+        WireProtocol::applyDelta(local, {bar(2, 20), bar(3, 33), bar(5, 50)}, bar(1, 0).m_timestamp);
+        FLASHFEED_CHECK(closes(local) == std::vector<double>({10, 20, 33, 50}));
+
+        WireProtocol::applyDelta(local, {bar(0, 1), bar(4, 40)}, bar(0, 0).m_timestamp);
+        FLASHFEED_CHECK(closes(local) == std::vector<double>({1, 10, 20, 33, 40, 50}));
+        FLASHFEED_CHECK_EQ(local[3].m_high, 34.0);
+
+        WireProtocol::applyDelta(local, {}, bar(0, 0).m_timestamp);
+        FLASHFEED_CHECK_EQ(local.size(), 6u);
+
+        // Bars before the first timestamp are dropped, even with no rows to merge
+        WireProtocol::applyDelta(local, {}, bar(2, 0).m_timestamp);
+        FLASHFEED_CHECK(closes(local) == std::vector<double>({20, 33, 40, 50}));
+        WireProtocol::applyDelta(local, {bar(6, 60)}, bar(5, 0).m_timestamp);
+        FLASHFEED_CHECK(closes(local) == std::vector<double>({50, 60}));
+    }
+
+    // A delta client kept up to date by UPDATE frames ends with the same bars
+    // as a series whose row limit drops old bars the frames never mention
+    void deltaClientFollowsARowLimitedSeries()
+    {
+        const std::size_t maxRows = 5;
+        ColumnarSeries series;
+        std::vector<MarketDataEntry> local;
+        std::int64_t minute = 0;
+        for (int round = 0; round < 20; ++round)
+        {
+            // New bars at the tail, sometimes with a revision of the newest held bar
+            std::vector<MarketDataEntry> incoming;
+            if (round % 3 == 2)
+            {
+                incoming.push_back(bar(minute - 1, static_cast<double>(round)));
+            }
+            for (int i = 0; i <= round % 4; ++i)
+            {
+                ++minute;
+                incoming.push_back(bar(minute, static_cast<double>(minute)));
+            }
+
+            ColumnarSeries next;
+            const SeriesUpdate update = ColumnarSeries::merge(series, incoming, next, maxRows);
+            FLASHFEED_CHECK(update.changed());
+            FLASHFEED_CHECK(!update.reset);
+            series = next;
+
+            const std::string text = WireProtocol::makeUpdateHeader("AAPL", update.previousSequence, update.sequence,
+                                                                    series.timestamps()[0], 0);
+            WireProtocol::FrameHeader header;
+            FLASHFEED_CHECK(WireProtocol::parseFrameHeader(line(text), header));
+            WireProtocol::applyDelta(local, series.changedSince(header.previousSequence), header.firstTimestamp);
+
+            FLASHFEED_CHECK_EQ(local.size(), series.size());
+            for (std::size_t i = 0; i < local.size() && i < series.size(); ++i)
+            {
+                if (!sameBits(local[i], series.row(i)))
+                {
+                    test::fail(__FILE__, __LINE__, "round " + std::to_string(round) + ": row " + std::to_string(i) + " differs");
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    textHeadersRoundTrip();
+    malformedTextHeadersAreRejected();
+    binaryHeaderLayout();
+    badBinaryHeadersAreRejected();
+    binaryRecordsRoundTrip();
+    applyDeltaMergesByTimestamp();
+    deltaClientFollowsARowLimitedSeries();
+    return test::finish("TestWireProtocol");
+}